@@ -2,8 +2,4 @@ git submodule update --init --recursive
 
 mkdir build
 
-echo "Generating test audio file"
-
-python media/wavToArray.py media/test.wav
-
 echo "Initialization Complete"
\ No newline at end of file
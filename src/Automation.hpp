@@ -0,0 +1,81 @@
+//====================================================================================================
+/* Automation.hpp
+
+Timestamped parameter changes for sample-accurate automation. The treeState only gives the
+audio thread one value per parameter per block, so a change lands wherever the host's buffer
+boundary happens to fall. Events in this queue carry their own time instead, in samples since
+prepareToPlay, and processBlock splits the block at them.
+
+Event times are rounded up to an absolute grid of kGrid samples. That bounds the cost (no
+sub-block is cut shorter by automation than the grid) and puts every split point in the same
+place whatever the buffer size, so a render with 64-sample blocks and one with 2048-sample
+blocks apply the same change at the same sample.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <juce_core/juce_core.h>
+#include "LockFreeRing.hpp"
+
+// One thread pushes events in time order, the audio thread applies them
+class AutomationQueue {
+public:
+  static constexpr int kGrid = 32;       // samples, the chain's control interval
+  static constexpr int kCapacity = 4096;
+  static constexpr juce::int64 kNever = std::numeric_limits<juce::int64>::max();
+
+  struct Event {
+    int param = 0;        // index in ParameterStack::forEachParameter order
+    float value = 0.f;    // in the parameter's own units
+    juce::int64 time = 0; // samples since prepareToPlay
+  };
+
+private:
+  LockFreeRing<Event> ring;
+  Event next;           // audio thread: popped but not yet due
+  bool hasNext = false;
+
+  bool peek() {
+    if (!this->hasNext) { this->hasNext = this->ring.pop(&this->next, 1) == 1; }
+    return this->hasNext;
+  }
+
+public:
+  AutomationQueue() { this->ring.prepare(kCapacity); }
+  ~AutomationQueue() {}
+
+  // never earlier than `time`, so an event pushed before the block holding its time is never late
+  static juce::int64 snap(juce::int64 time) {
+    const juce::int64 t = std::max<juce::int64>(time, 0);
+    return t + (kGrid - t % kGrid) % kGrid;
+  }
+
+  // only while the audio thread is stopped
+  void reset() {
+    this->ring.discard();
+    this->hasNext = false;
+  }
+
+  // producer: false if the queue is full. Events pushed out of order apply at the next split
+  bool push(const Event& e) { return this->ring.push(e); }
+  int getFreeSpace() const { return this->ring.getFreeSpace(); }
+
+  //==============================================================================
+  // audio thread
+
+  // grid time of the next event, kNever if there's none
+  juce::int64 nextTime() { return this->peek() ? snap(this->next.time) : kNever; }
+
+  // calls `apply(event)` for every event due at or before `position`
+  template <typename Fn>
+  void applyDue(juce::int64 position, Fn&& apply) {
+    while (this->peek() && snap(this->next.time) <= position) {
+      apply(this->next);
+      this->hasNext = false;
+    }
+  }
+};
@@ -0,0 +1,139 @@
+//====================================================================================================
+/* ChainOrderView.hpp
+
+The editor's strip for arranging the effects chain: one button per effect, in line order.
+Select an effect to move it earlier or later or take it out of the line; effects that are out
+come back at the end from the "Add" box. Every edit goes through the processor's
+setEffectOrder, which publishes it to the audio thread without locking, and the strip follows
+orders set elsewhere (state, presets) on its timer.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <juce_gui_basics/juce_gui_basics.h>
+
+class ChainOrderView : public juce::Component, private juce::Timer {
+private:
+  juce::StringArray names;
+  std::function<std::vector<int>()> getOrder;
+  std::function<void(const std::vector<int>&)> setOrder;
+
+  std::vector<int> requested; // the order as last read, for spotting changes from elsewhere
+  std::vector<int> shown;     // the same without repeats or unknown indices, as the chain runs it
+  int selected = -1;          // effect index, -1 for none
+
+  std::vector<std::unique_ptr<juce::TextButton>> stageButtons; // by effect index
+  juce::TextButton earlierButton { "<" };
+  juce::TextButton laterButton { ">" };
+  juce::TextButton removeButton { "Remove" };
+  juce::ComboBox addBox;
+
+  void timerCallback() override {
+    if (this->getOrder() != this->requested) { this->refresh(); }
+  }
+
+  int positionOf(int effect) const {
+    auto it = std::find(this->shown.begin(), this->shown.end(), effect);
+    return it == this->shown.end() ? -1 : static_cast<int>(it - this->shown.begin());
+  }
+
+  void refresh() {
+    this->requested = this->getOrder();
+    this->shown.clear();
+    for (int index : this->requested) {
+      if (index >= 0 && index < this->names.size() && this->positionOf(index) < 0) { this->shown.push_back(index); }
+    }
+    if (this->positionOf(this->selected) < 0) { this->selected = -1; }
+
+    this->addBox.clear(juce::dontSendNotification);
+    for (int i = 0; i < this->names.size(); i++) {
+      const bool inLine = this->positionOf(i) >= 0;
+      this->stageButtons[static_cast<size_t>(i)]->setVisible(inLine);
+      this->stageButtons[static_cast<size_t>(i)]->setToggleState(i == this->selected, juce::dontSendNotification);
+      if (!inLine) { this->addBox.addItem(this->names[i], i + 1); }
+    }
+    this->addBox.setEnabled(this->addBox.getNumItems() > 0);
+
+    const int pos = this->positionOf(this->selected);
+    this->earlierButton.setEnabled(pos > 0);
+    this->laterButton.setEnabled(pos >= 0 && pos + 1 < static_cast<int>(this->shown.size()));
+    this->removeButton.setEnabled(pos >= 0);
+    this->resized();
+  }
+
+  void apply(const std::vector<int>& order) {
+    this->setOrder(order);
+    this->refresh();
+  }
+
+  void move(int step) {
+    const int from = this->positionOf(this->selected);
+    const int to = from + step;
+    if (from < 0 || to < 0 || to >= static_cast<int>(this->shown.size())) { return; }
+    auto order = this->shown;
+    std::swap(order[static_cast<size_t>(from)], order[static_cast<size_t>(to)]);
+    this->apply(order);
+  }
+
+  void remove() {
+    auto order = this->shown;
+    order.erase(std::remove(order.begin(), order.end(), this->selected), order.end());
+    this->selected = -1;
+    this->apply(order);
+  }
+
+  void add(int effect) {
+    if (effect < 0 || this->positionOf(effect) >= 0) { return; }
+    auto order = this->shown;
+    order.push_back(effect);
+    this->selected = effect;
+    this->apply(order);
+  }
+
+public:
+  ChainOrderView(const juce::StringArray& effectNames, std::function<std::vector<int>()> getOrderFn,
+                 std::function<void(const std::vector<int>&)> setOrderFn)
+      : names(effectNames), getOrder(std::move(getOrderFn)), setOrder(std::move(setOrderFn)) {
+    for (int i = 0; i < this->names.size(); i++) {
+      this->stageButtons.push_back(std::make_unique<juce::TextButton>(this->names[i]));
+      auto& button = *this->stageButtons.back();
+      button.onClick = [this, i] {
+        this->selected = this->selected == i ? -1 : i;
+        this->refresh();
+      };
+      this->addChildComponent(button);
+    }
+    this->earlierButton.onClick = [this] { this->move(-1); };
+    this->laterButton.onClick = [this] { this->move(1); };
+    this->removeButton.onClick = [this] { this->remove(); };
+    this->addBox.setTextWhenNothingSelected("Add");
+    this->addBox.setTextWhenNoChoicesAvailable("All in line");
+    this->addBox.onChange = [this] { this->add(this->addBox.getSelectedId() - 1); };
+    this->addAndMakeVisible(this->earlierButton);
+    this->addAndMakeVisible(this->laterButton);
+    this->addAndMakeVisible(this->removeButton);
+    this->addAndMakeVisible(this->addBox);
+
+    this->refresh();
+    this->startTimerHz(5);
+  }
+
+  void resized() override {
+    auto area = this->getLocalBounds();
+    this->addBox.setBounds(area.removeFromRight(90));
+    this->removeButton.setBounds(area.removeFromRight(64));
+    this->laterButton.setBounds(area.removeFromRight(24));
+    this->earlierButton.setBounds(area.removeFromRight(24));
+
+    const int width = this->shown.empty() ? 0 : area.getWidth() / static_cast<int>(this->shown.size());
+    for (int index : this->shown) {
+      this->stageButtons[static_cast<size_t>(index)]->setBounds(area.removeFromLeft(width));
+    }
+  }
+};
@@ -0,0 +1,737 @@
+//====================================================================================================
+/* ConvolutionReverb.hpp
+
+Convolution mode for the reverb stage, next to giml::Reverb's algorithmic room model. The
+impulse response is split three ways so the stage adds no latency and the audio thread only
+pays for the start of the IR:
+
+  - the first kHeadLength taps run as a direct-form FIR,
+  - up to kTailStart, uniform partitions of kMidBlock samples run on the audio thread,
+  - the rest runs in kTailBlock partitions on a worker thread. A tail block is due one block
+    after its input is complete, so the worker has a whole block of slack.
+
+IRs are loaded from a file or synthesized from the room model's parameters. Parameter changes
+are debounced and built on ImpulseBuilder's thread; each new IR is published with an atomic
+exchange, like ChainOrder, and the audio thread crossfades to it from the outgoing one over
+kFadeMs instead of restarting from silence.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_dsp/juce_dsp.h>
+#include "EffectsChain.hpp"
+
+// Uniformly partitioned overlap-save convolution with one IR segment, blockSize samples per call
+class PartitionedConvolver {
+private:
+  int blockSize = 0;
+  int numPartitions = 0;
+  int stride = 0;  // floats per spectrum: blockSize + 1 interleaved complex bins
+  int delayPos = 0;
+  std::unique_ptr<juce::dsp::FFT> fft;
+  std::vector<float> partitions; // the segment's spectra, one per partition
+  std::vector<float> delayLine;  // spectra of the last numPartitions input blocks
+  std::vector<float> window;     // the last 2 * blockSize input samples
+  std::vector<float> work;       // FFT buffer, 2 * fftSize as juce::dsp::FFT wants
+  std::vector<float> accum;
+
+public:
+  PartitionedConvolver() {}
+  ~PartitionedConvolver() {}
+
+  // Not real-time safe. `length` samples of `ir`, zero-padded to whole partitions
+  void prepare(const float* ir, int length, int block) {
+    this->blockSize = block;
+    this->numPartitions = std::max(0, (length + block - 1) / block);
+    this->stride = 2 * (block + 1);
+    this->delayPos = 0;
+    this->fft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(2 * block)));
+    this->window.assign(static_cast<size_t>(2 * block), 0.f);
+    this->work.assign(static_cast<size_t>(4 * block), 0.f);
+    this->accum.assign(static_cast<size_t>(this->stride), 0.f);
+    this->delayLine.assign(static_cast<size_t>(this->numPartitions * this->stride), 0.f);
+    this->partitions.assign(static_cast<size_t>(this->numPartitions * this->stride), 0.f);
+
+    for (int p = 0; p < this->numPartitions; p++) {
+      std::fill(this->work.begin(), this->work.end(), 0.f);
+      const int n = std::min(block, length - p * block);
+      std::copy(ir + p * block, ir + p * block + n, this->work.begin());
+      this->fft->performRealOnlyForwardTransform(this->work.data(), true);
+      std::copy(this->work.begin(), this->work.begin() + this->stride, this->partitions.begin() + p * this->stride);
+    }
+  }
+
+  bool isEmpty() const { return this->numPartitions == 0; }
+
+  // forgets the input so far, keeps the IR
+  void reset() {
+    this->delayPos = 0;
+    std::fill(this->window.begin(), this->window.end(), 0.f);
+    std::fill(this->delayLine.begin(), this->delayLine.end(), 0.f);
+  }
+
+  // convolves the next blockSize samples of `in` and adds blockSize samples to `out`
+  void process(const float* in, float* out) {
+    if (this->numPartitions == 0) { return; }
+    const int block = this->blockSize;
+
+    std::copy(this->window.begin() + block, this->window.end(), this->window.begin());
+    std::copy(in, in + block, this->window.begin() + block);
+    std::copy(this->window.begin(), this->window.end(), this->work.begin());
+    std::fill(this->work.begin() + 2 * block, this->work.end(), 0.f);
+    this->fft->performRealOnlyForwardTransform(this->work.data(), true);
+    std::copy(this->work.begin(), this->work.begin() + this->stride, this->delayLine.begin() + this->delayPos * this->stride);
+
+    // frequency-domain delay line: input block k - p meets partition p
+    std::fill(this->accum.begin(), this->accum.end(), 0.f);
+    float* acc = this->accum.data();
+    for (int p = 0; p < this->numPartitions; p++) {
+      const int slot = (this->delayPos - p + this->numPartitions) % this->numPartitions;
+      const float* x = this->delayLine.data() + slot * this->stride;
+      const float* h = this->partitions.data() + p * this->stride;
+      for (int k = 0; k < this->stride; k += 2) {
+        acc[k] += x[k] * h[k] - x[k + 1] * h[k + 1];
+        acc[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+      }
+    }
+    this->delayPos = (this->delayPos + 1) % this->numPartitions;
+
+    std::copy(this->accum.begin(), this->accum.end(), this->work.begin());
+    std::fill(this->work.begin() + this->stride, this->work.end(), 0.f);
+    this->fft->performRealOnlyInverseTransform(this->work.data());
+
+    // overlap-save: the second half is free of circular wrap-around
+    for (int i = 0; i < block; i++) {
+      out[i] += this->work[static_cast<size_t>(block + i)];
+    }
+  }
+};
+
+// Impulse responses for ConvolutionReverb
+namespace ImpulseResponse {
+  constexpr double kMaxSeconds = 10.0;
+
+  // the room model's parameters, as giml::Reverb takes them
+  struct Room {
+    int type = 0;            // reverbRoomType: Cube, Sphere, Square Pyramid, Cylinder, Custom
+    float length = 50.f;     // m
+    float absorption = 0.9f; // average absorption coefficient of the surfaces
+    float damping = 0.5f;    // high-frequency loss over the decay
+    float customTime = 1.f;  // decay time in s for the Custom room
+  };
+
+  // RT60 from Sabine's formula, 0.161 V / (S a), for a room `length` metres across
+  inline double decayTime(const Room& room) {
+    const double l = std::max(room.length, 0.1f);
+    const double pi = juce::MathConstants<double>::pi;
+    double volume = l * l * l, surface = 6.0 * l * l; // Cube
+    switch (room.type) {
+      case 1: volume = pi / 6.0 * l * l * l; surface = pi * l * l; break;                // Sphere
+      case 2: volume = l * l * l / 3.0; surface = l * l * (1.0 + std::sqrt(5.0)); break; // Square Pyramid, height l
+      case 3: volume = pi / 4.0 * l * l * l; surface = 1.5 * pi * l * l; break;          // Cylinder, height l
+      case 4: return juce::jlimit(0.05, kMaxSeconds, static_cast<double>(room.customTime));
+      default: break;
+    }
+    const double absorption = std::max(static_cast<double>(room.absorption), 0.01);
+    return juce::jlimit(0.05, kMaxSeconds, 0.161 * volume / (surface * absorption));
+  }
+
+  // Stereo exponentially decaying noise, decorrelated between channels, that darkens as it
+  // decays. The first reflection arrives after the room's length at the speed of sound.
+  // Normalized to unit energy per channel, so the wet level doesn't follow the room size
+  inline juce::AudioBuffer<float> synthesize(const Room& room, double sampleRate) {
+    const double rt60 = decayTime(room);
+    const int preDelay = static_cast<int>(std::min(0.5, room.length / 343.0) * sampleRate);
+    const int length = preDelay + static_cast<int>(rt60 * sampleRate);
+    juce::AudioBuffer<float> ir(2, std::max(length, 1));
+    ir.clear();
+
+    const double decayPerSample = std::exp(-6.907755 / (rt60 * sampleRate)); // -60 dB over rt60
+    for (int ch = 0; ch < ir.getNumChannels(); ch++) {
+      juce::Random random(ch + 1);
+      float* dest = ir.getWritePointer(ch);
+      double envelope = 1.0, energy = 0.0;
+      float lowpass = 0.f;
+      for (int i = preDelay; i < length; i++) {
+        const float t = static_cast<float>(i - preDelay) / static_cast<float>(length - preDelay);
+        const float coefficient = juce::jlimit(0.f, 0.95f, room.damping * t);
+        lowpass = (1.f - coefficient) * (random.nextFloat() * 2.f - 1.f) + coefficient * lowpass;
+        dest[i] = static_cast<float>(lowpass * envelope);
+        energy += dest[i] * dest[i];
+        envelope *= decayPerSample;
+      }
+      if (energy > 0.0) { ir.applyGain(ch, 0, length, static_cast<float>(1.0 / std::sqrt(energy))); }
+    }
+    return ir;
+  }
+
+  // Reads an IR file, at most kMaxSeconds of it. Returns false if it can't be read
+  inline bool load(const juce::File& file, juce::AudioBuffer<float>& ir, double& sampleRate) {
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0) { return false; }
+
+    const auto length = static_cast<int>(std::min<juce::int64>(reader->lengthInSamples,
+                                                                static_cast<juce::int64>(kMaxSeconds * reader->sampleRate)));
+    ir.setSize(static_cast<int>(std::min<unsigned int>(reader->numChannels, kMaxChannels)), length);
+    reader->read(&ir, 0, length, 0, true, ir.getNumChannels() > 1);
+    sampleRate = reader->sampleRate;
+    return true;
+  }
+
+  // produces an IR at the sample rate it's given, e.g. by synthesize() or resample()
+  using Maker = std::function<juce::AudioBuffer<float>(double sampleRate)>;
+
+  // converts `ir` to `targetRate`, no-op when the rates match
+  inline juce::AudioBuffer<float> resample(const juce::AudioBuffer<float>& ir, double irRate, double targetRate) {
+    if (irRate <= 0.0 || targetRate <= 0.0 || irRate == targetRate) { return ir; }
+    const double ratio = irRate / targetRate;
+    const int length = static_cast<int>(ir.getNumSamples() / ratio);
+    juce::AudioBuffer<float> out(ir.getNumChannels(), std::max(length, 1));
+    for (int ch = 0; ch < ir.getNumChannels(); ch++) {
+      juce::LagrangeInterpolator interpolator;
+      interpolator.process(ratio, ir.getReadPointer(ch), out.getWritePointer(ch), out.getNumSamples(),
+                           ir.getNumSamples(), 0);
+    }
+    return out;
+  }
+} // namespace ImpulseResponse
+
+class ConvolutionReverb : private juce::Thread {
+public:
+  static constexpr int kHeadLength = 64;
+  static constexpr int kMidBlock = 64;
+  static constexpr int kTailBlock = 1024;
+  static constexpr int kTailStart = 2 * kTailBlock;
+  static constexpr double kFadeMs = 250.0; // crossfade from the outgoing IR to a new one
+  static_assert(kHeadLength == kMidBlock, "the mid partitions start where the head ends, one block in");
+
+private:
+  static constexpr int kSlots = 8;       // tail blocks in flight between the audio thread and the worker
+  static constexpr int kFadeChunk = 256; // the outgoing engine runs in spans of this many samples
+
+  struct Channel {
+    std::vector<float> head;    // first kHeadLength taps, reversed
+    std::vector<float> history; // 2 * kHeadLength, every input written twice so the FIR reads one span
+    int historyPos = 0;
+    PartitionedConvolver mid, tail;
+    std::vector<float> midIn, midOut;
+    std::vector<float> tailIn, tailOut; // kSlots blocks each
+  };
+
+  // one IR and all of its convolution state
+  struct Engine {
+    Channel channels[kMaxChannels];
+    int numChannels = 0;
+    bool hasTail = false;
+    uint64_t sequence = 0; // publication order, see acknowledged
+
+    // audio thread
+    int midPos = 0;
+    int tailPos = 0;
+    juce::int64 block = 0;  // tail block being filled, also the one being output
+    bool tailReady = false; // the worker's output for `block` has arrived
+
+    std::atomic<juce::int64> submitted { 0 }; // tail blocks handed to the worker
+    std::atomic<juce::int64> done { 0 };      // tail blocks the worker has convolved
+
+    // back to silence with the same IR; neither thread may be using it
+    void reset() {
+      for (int ch = 0; ch < this->numChannels; ch++) {
+        Channel& c = this->channels[ch];
+        std::fill(c.history.begin(), c.history.end(), 0.f);
+        c.historyPos = 0;
+        c.mid.reset();
+        c.tail.reset();
+        for (auto* buffer : { &c.midIn, &c.midOut, &c.tailIn, &c.tailOut }) { std::fill(buffer->begin(), buffer->end(), 0.f); }
+      }
+      this->midPos = 0;
+      this->tailPos = 0;
+      this->block = 0;
+      this->tailReady = false;
+      this->submitted.store(0);
+      this->done.store(0);
+    }
+  };
+
+  // Published like ChainOrder: the setup side swaps new engines into `pending` and frees only
+  // those older than the oldest one the audio thread has acknowledged. The worker marks the
+  // engine it's convolving as a hazard on top
+  juce::CriticalSection setupLock; // the setup side: engines, prepare, release
+  std::vector<std::unique_ptr<Engine>> engines;
+  uint64_t lastSequence = 0;
+  std::atomic<Engine*> pending { nullptr };
+  std::atomic<uint64_t> acknowledged { 0 };
+  std::atomic<Engine*> inUse { nullptr };     // the audio thread's engines, for the worker
+  std::atomic<Engine*> fadingOut { nullptr };
+  std::atomic<Engine*> workerEngine { nullptr };
+
+  // audio thread
+  Engine* current = nullptr;
+  Engine* fading = nullptr; // the previous IR while it crossfades to `current`
+  int fadePos = 0;
+
+  double sampleRate = 0.0;
+  int numChannels = kMaxChannels;
+  SharedTable fade;
+  int fadeLength = 0;
+  std::vector<float> fadeWet[kMaxChannels];
+  std::atomic<bool> synchronous { false };
+  std::atomic<int> lateBlocks { 0 };
+  std::atomic<double> irSeconds { 0.0 };
+
+  static std::unique_ptr<Engine> build(const juce::AudioBuffer<float>& ir, int numChannels) {
+    auto e = std::make_unique<Engine>();
+    e->numChannels = std::min(numChannels, kMaxChannels);
+    const int length = ir.getNumSamples();
+    e->hasTail = length > kTailStart;
+
+    for (int ch = 0; ch < e->numChannels; ch++) {
+      Channel& c = e->channels[ch];
+      const float* taps = ir.getReadPointer(std::min(ch, ir.getNumChannels() - 1));
+
+      c.head.assign(kHeadLength, 0.f);
+      for (int i = 0; i < std::min(length, kHeadLength); i++) {
+        c.head[static_cast<size_t>(kHeadLength - 1 - i)] = taps[i];
+      }
+      c.history.assign(2 * kHeadLength, 0.f);
+
+      const int midLength = juce::jlimit(0, kTailStart - kHeadLength, length - kHeadLength);
+      c.mid.prepare(taps + kHeadLength, midLength, kMidBlock);
+      c.midIn.assign(kMidBlock, 0.f);
+      c.midOut.assign(kMidBlock, 0.f);
+
+      c.tail.prepare(taps + kTailStart, std::max(0, length - kTailStart), kTailBlock);
+      c.tailIn.assign(kSlots * kTailBlock, 0.f);
+      c.tailOut.assign(kSlots * kTailBlock, 0.f);
+    }
+    return e;
+  }
+
+  // setup side: free the engines the audio thread has moved past and the worker isn't in
+  void collectGarbage() {
+    const uint64_t oldest = this->acknowledged.load();
+    Engine* w = this->workerEngine.load();
+    this->engines.erase(std::remove_if(this->engines.begin(), this->engines.end(),
+                                       [oldest, w](const std::unique_ptr<Engine>& e) {
+                                         return e->sequence < oldest && e.get() != w;
+                                       }),
+                        this->engines.end());
+  }
+
+  // an engine taken back from `pending` before the audio thread saw it
+  void dropEngine(Engine* engine) {
+    this->engines.erase(std::remove_if(this->engines.begin(), this->engines.end(),
+                                       [engine](const std::unique_ptr<Engine>& e) { return e.get() == engine; }),
+                        this->engines.end());
+  }
+
+  static void convolveTail(Engine& e, juce::int64 block) {
+    const int offset = static_cast<int>(block % kSlots) * kTailBlock;
+    for (int ch = 0; ch < e.numChannels; ch++) {
+      Channel& c = e.channels[ch];
+      std::fill(c.tailOut.begin() + offset, c.tailOut.begin() + offset + kTailBlock, 0.f);
+      c.tail.process(c.tailIn.data() + offset, c.tailOut.data() + offset);
+    }
+  }
+
+  // worker: convolves the engine's next submitted tail block, if any. Returns true if it did
+  bool convolveNext(Engine& e) {
+    if (!e.hasTail || this->synchronous.load()) { return false; }
+    juce::int64 next = e.done.load();
+    const juce::int64 submitted = e.submitted.load(std::memory_order_acquire);
+    if (submitted - next > kSlots / 2) { next = submitted - 1; } // too late to be heard, skip ahead
+    if (next >= submitted) { return false; }
+    convolveTail(e, next);
+    e.done.store(next + 1, std::memory_order_release);
+    return true;
+  }
+
+  void run() override {
+    while (!this->threadShouldExit()) {
+      bool worked = false;
+      for (auto* slot : { &this->inUse, &this->fadingOut }) {
+        // hazard pointer: re-check after marking, so the setup side can't free it under us
+        Engine* e = slot->load();
+        this->workerEngine.store(e);
+        if (e == nullptr || e != slot->load()) { continue; }
+        worked |= this->convolveNext(*e);
+      }
+      this->workerEngine.store(nullptr);
+      // polled: waking the worker from the audio thread would take a lock
+      if (!worked) { this->wait(1); }
+    }
+  }
+
+  // audio thread, at the start of each tail block
+  void beginTailBlock(Engine& e) {
+    e.tailReady = false;
+    if (!e.hasTail || e.block < 2) { return; }
+    e.tailReady = e.done.load(std::memory_order_acquire) >= e.block - 1;
+    if (!e.tailReady) { this->lateBlocks.fetch_add(1, std::memory_order_relaxed); }
+  }
+
+  void endTailBlock(Engine& e) {
+    if (e.hasTail) {
+      if (this->synchronous.load(std::memory_order_relaxed)) {
+        convolveTail(e, e.block);
+        e.done.store(e.block + 1, std::memory_order_release);
+      }
+      e.submitted.store(e.block + 1, std::memory_order_release);
+    }
+    e.block++;
+    e.tailPos = 0;
+  }
+
+  // head FIR plus the mid and tail outputs for `span` samples that stay within one block of each
+  static void processSpan(Engine& e, Channel& c, const float* in, float* wet, int span) {
+    const float* head = c.head.data();
+    const float* midOut = c.midOut.data() + e.midPos;
+    const float* tailOut = c.tailOut.data() + (e.block - 2 + kSlots) % kSlots * kTailBlock + e.tailPos;
+    for (int i = 0; i < span; i++) {
+      c.history[static_cast<size_t>(c.historyPos)] = in[i];
+      c.history[static_cast<size_t>(c.historyPos + kHeadLength)] = in[i];
+      c.historyPos = (c.historyPos + 1) % kHeadLength;
+
+      const float* recent = c.history.data() + c.historyPos; // oldest to newest
+      float y = 0.f;
+      for (int j = 0; j < kHeadLength; j++) { y += head[j] * recent[j]; }
+      y += midOut[i];
+      if (e.tailReady) { y += tailOut[i]; }
+      wet[i] = y;
+    }
+    std::copy(in, in + span, c.midIn.begin() + e.midPos);
+    std::copy(in, in + span, c.tailIn.begin() + static_cast<int>(e.block % kSlots) * kTailBlock + e.tailPos);
+  }
+
+  // runs one engine over the block
+  void render(Engine& e, const float* const* in, float* const* wet, int channels, int numSamples) {
+    const int numActive = std::min(channels, e.numChannels);
+    for (int ch = numActive; ch < channels; ch++) {
+      std::fill(wet[ch], wet[ch] + numSamples, 0.f);
+    }
+
+    int done = 0;
+    while (done < numSamples) {
+      if (e.tailPos == 0) { this->beginTailBlock(e); }
+      const int span = std::min({ numSamples - done, kMidBlock - e.midPos, kTailBlock - e.tailPos });
+      for (int ch = 0; ch < numActive; ch++) {
+        processSpan(e, e.channels[ch], in[ch] + done, wet[ch] + done, span);
+      }
+      e.midPos += span;
+      e.tailPos += span;
+      done += span;
+
+      if (e.midPos == kMidBlock) {
+        for (int ch = 0; ch < e.numChannels; ch++) {
+          Channel& c = e.channels[ch];
+          std::fill(c.midOut.begin(), c.midOut.end(), 0.f);
+          c.mid.process(c.midIn.data(), c.midOut.data());
+        }
+        e.midPos = 0;
+      }
+      if (e.tailPos == kTailBlock) { this->endTailBlock(e); }
+    }
+  }
+
+  // mixes the outgoing engine's output under `wet` along the equal-power fade, and lets it go
+  // once the fade is through
+  void fadeOut(const float* const* in, float* const* wet, int channels, int numSamples) {
+    const float* gains = this->fade->data();
+    const float* inSub[kMaxChannels];
+    float* oldWet[kMaxChannels];
+    for (int start = 0; start < numSamples;) {
+      const int span = std::min(numSamples - start, kFadeChunk);
+      for (int ch = 0; ch < channels; ch++) {
+        inSub[ch] = in[ch] + start;
+        oldWet[ch] = this->fadeWet[ch].data();
+      }
+      this->render(*this->fading, inSub, oldWet, channels, span);
+
+      int pos = this->fadePos;
+      for (int i = 0; i < span; i++) {
+        pos = std::min(pos + 1, this->fadeLength);
+        const float newGain = gains[pos];
+        const float oldGain = gains[this->fadeLength - pos];
+        for (int ch = 0; ch < channels; ch++) {
+          wet[ch][start + i] = wet[ch][start + i] * newGain + oldWet[ch][i] * oldGain;
+        }
+      }
+      this->fadePos = pos;
+      start += span;
+    }
+
+    if (this->fadePos >= this->fadeLength) {
+      this->fading = nullptr;
+      this->fadingOut.store(nullptr);
+      this->acknowledged.store(this->current->sequence);
+    }
+  }
+
+public:
+  ConvolutionReverb() : juce::Thread("Convolution tail") {}
+
+  // called on the setup side after a new IR is published, e.g. to update the tail length
+  std::function<void()> onImpulseChanged;
+  ~ConvolutionReverb() { this->release(); }
+
+  //==============================================================================
+  // setup side: the message thread, or ImpulseBuilder's thread for setImpulseResponse
+
+  // Rate and layout for the IRs set from now on. `offline` convolves the tail on the audio
+  // thread instead, for renders that run faster than real time. Only while the audio thread
+  // is stopped
+  void prepare(double sr, int channels, bool offline) {
+    const juce::ScopedLock sl(this->setupLock);
+    this->sampleRate = sr;
+    this->numChannels = std::max(1, std::min(channels, kMaxChannels));
+    this->synchronous.store(offline);
+    this->fade = SharedTables::equalPowerFade(sr, kFadeMs);
+    this->fadeLength = static_cast<int>(this->fade->size()) - 1;
+    for (auto& channel : this->fadeWet) { channel.assign(kFadeChunk, 0.f); }
+  }
+
+  bool isPreparedFor(double sr, int channels, bool offline) const {
+    const juce::ScopedLock sl(this->setupLock);
+    return sr == this->sampleRate && std::max(1, std::min(channels, kMaxChannels)) == this->numChannels
+        && offline == this->synchronous.load() && !this->engines.empty();
+  }
+
+  // Builds the convolution for the IR `make` returns at the prepared rate and hands it to the
+  // audio thread, which crossfades to it from the current one. Not real-time safe
+  void setImpulseResponse(const ImpulseResponse::Maker& make) {
+    const juce::ScopedLock sl(this->setupLock);
+    if (this->sampleRate <= 0.0 || !make) { return; }
+    const auto ir = make(this->sampleRate);
+    if (ir.getNumSamples() == 0) { return; }
+
+    auto engine = build(ir, this->numChannels);
+    engine->sequence = ++this->lastSequence;
+    Engine* published = engine.get();
+    this->engines.push_back(std::move(engine));
+    if (Engine* unseen = this->pending.exchange(published)) { this->dropEngine(unseen); }
+    this->collectGarbage();
+    this->irSeconds.store(ir.getNumSamples() / this->sampleRate);
+    if (this->onImpulseChanged) { this->onImpulseChanged(); }
+
+    if (published->hasTail && !this->synchronous.load() && !this->isThreadRunning()) {
+      this->startThread(juce::Thread::Priority::high);
+    }
+  }
+
+  // Restarts the IRs from silence, keeping their convolution. Only while the audio thread
+  // is stopped; the worker is stopped for it too
+  void reset() {
+    const juce::ScopedLock sl(this->setupLock);
+    const bool running = this->isThreadRunning();
+    this->stopThread(1000);
+    for (auto& engine : this->engines) { engine->reset(); }
+    if (this->fading != nullptr) { // the fade would bring the old IR back in from silence
+      this->fading = nullptr;
+      this->fadingOut.store(nullptr);
+      this->acknowledged.store(this->current->sequence);
+    }
+    if (running) { this->startThread(juce::Thread::Priority::high); }
+  }
+
+  // only while the audio thread is stopped
+  void release() {
+    const juce::ScopedLock sl(this->setupLock);
+    this->stopThread(1000);
+    this->pending.store(nullptr);
+    this->inUse.store(nullptr);
+    this->fadingOut.store(nullptr);
+    this->acknowledged.store(0);
+    this->current = nullptr;
+    this->fading = nullptr;
+    this->engines.clear();
+    this->sampleRate = 0.0; // IRs built from here on wait for the next prepare
+    this->irSeconds.store(0.0);
+  }
+
+  // tail blocks the worker delivered too late to be heard, since the last call
+  int getLateBlocks() { return this->lateBlocks.exchange(0); }
+
+  // length of the current IR, which is how long the reverb rings; any thread
+  double getImpulseSeconds() const { return this->irSeconds.load(); }
+
+  //==============================================================================
+  // audio thread
+
+  // writes the reverb of `in` (wet only) to `wet`; silence until an IR is set
+  void process(const float* const* in, float* const* wet, int channels, int numSamples) {
+    // a new IR waits for a running crossfade to finish
+    if (this->fading == nullptr) {
+      if (Engine* next = this->pending.exchange(nullptr, std::memory_order_acq_rel)) {
+        if (this->current != nullptr && this->fadeLength > 0) {
+          this->fading = this->current;
+          this->fadePos = 0;
+          this->fadingOut.store(this->fading);
+        }
+        this->current = next;
+        this->inUse.store(next);
+        this->acknowledged.store((this->fading != nullptr ? this->fading : next)->sequence);
+      }
+    }
+
+    if (this->current == nullptr) {
+      for (int ch = 0; ch < channels; ch++) { std::fill(wet[ch], wet[ch] + numSamples, 0.f); }
+      return;
+    }
+    this->render(*this->current, in, wet, channels, numSamples);
+    if (this->fading != nullptr) { this->fadeOut(in, wet, channels, numSamples); }
+  }
+};
+
+// Builds requested IRs on a thread of its own, off the message thread. A request replaces
+// any still waiting and restarts the wait, so a knob sweep builds one IR once it settles
+class ImpulseBuilder : private juce::Thread {
+private:
+  ConvolutionReverb& target;
+  juce::CriticalSection lock; // guards the waiting request
+  ImpulseResponse::Maker waiting;
+  double due = 0.0; // when to build it, in getMillisecondCounterHiRes() time
+
+  void run() override {
+    while (!this->threadShouldExit()) {
+      ImpulseResponse::Maker make;
+      int waitMs = -1;
+      {
+        const juce::ScopedLock sl(this->lock);
+        if (this->waiting) {
+          const double remaining = this->due - juce::Time::getMillisecondCounterHiRes();
+          if (remaining <= 0.0) {
+            make = std::move(this->waiting);
+            this->waiting = nullptr;
+          } else {
+            waitMs = static_cast<int>(std::ceil(remaining));
+          }
+        }
+      }
+      if (make) {
+        this->target.setImpulseResponse(make);
+      } else {
+        this->wait(waitMs);
+      }
+    }
+  }
+
+public:
+  explicit ImpulseBuilder(ConvolutionReverb& reverb) : juce::Thread("Impulse builder"), target(reverb) {}
+  ~ImpulseBuilder() { this->stopThread(4000); }
+
+  // builds `make`'s IR `delayMs` from now, unless another request comes first
+  void request(ImpulseResponse::Maker make, int delayMs) {
+    {
+      const juce::ScopedLock sl(this->lock);
+      this->waiting = std::move(make);
+      this->due = juce::Time::getMillisecondCounterHiRes() + delayMs;
+    }
+    if (!this->isThreadRunning()) {
+      this->startThread();
+    } else {
+      this->notify();
+    }
+  }
+
+  // drops the waiting request; one already building still lands
+  void cancel() {
+    const juce::ScopedLock sl(this->lock);
+    this->waiting = nullptr;
+  }
+};
+
+// giml::Reverb's slot with the convolution mode beside it. The mode parameter picks which runs;
+// the blend applies to both
+class ReverbSlot : public EffectSlot<giml::Reverb<float>> {
+private:
+  ConvolutionReverb convolution;
+  ImpulseBuilder builder { convolution }; // declared after, so it stops first
+  Parameter* modeParam = nullptr; // 0 runs giml::Reverb, anything else the convolution
+  float blend = 0.5f;
+  std::vector<float> wet[kMaxChannels];
+
+public:
+  ReverbSlot() {}
+  ~ReverbSlot() {}
+
+  void setModeParam(Parameter& mode) { this->modeParam = &mode; }
+  bool isConvolution() const { return this->modeParam != nullptr && this->modeParam->getIndex() > 0; }
+
+  // Not real-time safe. Returns true if the IR has to be set again; with the same rate,
+  // layout, block size and mode the current one is kept and only cleared
+  bool prepareConvolution(double sampleRate, int numChannels, int maxBlockSize, bool offline) {
+    const size_t chunk = static_cast<size_t>(std::max(maxBlockSize, 1));
+    if (this->convolution.isPreparedFor(sampleRate, numChannels, offline) && this->wet[0].size() == chunk) {
+      this->convolution.reset();
+      return false;
+    }
+    this->convolution.release();
+    this->convolution.prepare(sampleRate, numChannels, offline);
+    for (auto& channel : this->wet) { channel.assign(chunk, 0.f); }
+    return true;
+  }
+
+  // builds the IR before returning, for prepareToPlay; replaces any waiting request
+  void setImpulseResponse(const ImpulseResponse::Maker& make) {
+    this->builder.cancel();
+    this->convolution.setImpulseResponse(make);
+  }
+
+  // builds the IR on the builder thread `delayMs` from now; an empty `make` just cancels
+  void requestImpulseResponse(ImpulseResponse::Maker make, int delayMs) {
+    if (make) {
+      this->builder.request(std::move(make), delayMs);
+    } else {
+      this->builder.cancel();
+    }
+  }
+
+  void setImpulseListener(std::function<void()> fn) { this->convolution.onImpulseChanged = std::move(fn); }
+
+  void releaseConvolution() {
+    this->builder.cancel();
+    this->convolution.release();
+  }
+  int getLateBlocks() { return this->convolution.getLateBlocks(); }
+  double getImpulseSeconds() const { return this->convolution.getImpulseSeconds(); }
+
+  // wet/dry mix in convolution mode, set alongside the giml params
+  void setBlend(float b) { this->blend = b; }
+
+  void processBlock(const float* const* in, float* const* out, int numChannels, int numSamples) override {
+    if (!this->isConvolution()) {
+      EffectSlot<giml::Reverb<float>>::processBlock(in, out, numChannels, numSamples);
+      return;
+    }
+
+    jassert(numChannels <= kMaxChannels);
+    const int chunk = static_cast<int>(this->wet[0].size());
+    const float* inSub[kMaxChannels];
+    float* wetSub[kMaxChannels];
+    for (int start = 0; start < numSamples; start += chunk) {
+      const int length = std::min(chunk, numSamples - start);
+      for (int ch = 0; ch < numChannels; ch++) {
+        inSub[ch] = in[ch] + start;
+        wetSub[ch] = this->wet[ch].data();
+      }
+      this->convolution.process(inSub, wetSub, numChannels, length);
+      for (int ch = 0; ch < numChannels; ch++) {
+        for (int i = 0; i < length; i++) {
+          out[ch][start + i] = inSub[ch][i] * (1.f - this->blend) + wetSub[ch][i] * this->blend;
+        }
+      }
+    }
+  }
+};
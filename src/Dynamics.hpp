@@ -0,0 +1,123 @@
+//====================================================================================================
+/* Dynamics.hpp
+
+Compressor and envelope filter built on FastMath instead of the std:: calls giml's run per
+sample, benchmarked against giml's in GIMMEL-BENCH. The processor runs the giml effects; these
+keep the shape of one (built from the sample rate, setParams, toggle, processSample) and take
+the same parameters, so either fits an EffectSlot or OversampledSlot:
+
+  - FastCompressor follows each sample's level in dB through a soft-knee gain computer
+    (threshold, ratio, knee width) and smooths the gain change with attack/release times,
+  - FastEnvelopeFilter follows the input's level with attack/release times and sweeps a
+    band-pass of the given Q across four octaves from 200 Hz with it.
+
+The level detectors and the filter's coefficients are recomputed every sample, which is where
+FastMath's dB <-> gain, exp2 and tan take over.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "FastMath.hpp"
+
+namespace Dynamics {
+  // per-sample coefficient of a one-pole smoother that covers 1 - 1/e of a step in `ms`;
+  // 0 ms follows the input
+  inline float smoothing(float ms, float sampleRate) {
+    if (ms <= 0.f) { return 0.f; }
+    return FastMath::exp2(-1.44269504f / (ms * 0.001f * sampleRate)); // e^(-1 / samples)
+  }
+} // namespace Dynamics
+
+class FastCompressor {
+private:
+  float sampleRate;
+  float threshold = 0.f; // dB
+  float slope = -0.5f;   // 1 / ratio - 1, the gain change in dB per dB over the threshold
+  float makeup = 0.f;    // dB
+  float knee = 1.f;      // dB, the width of the transition around the threshold
+  float attack = 0.f, release = 0.f;
+  float reduction = 0.f; // smoothed gain change in dB, <= 0
+  bool enabled = false;
+
+public:
+  explicit FastCompressor(int sr) : sampleRate(static_cast<float>(sr)) { this->setParams(); }
+
+  void toggle(bool on) { this->enabled = on; }
+
+  // threshold, makeup and knee in dB, attack and release in ms
+  void setParams(float thresholdDb = 0.f, float ratio = 2.f, float makeupDb = 0.f, float kneeDb = 1.f,
+                 float attackMs = 3.5f, float releaseMs = 100.f) {
+    this->threshold = thresholdDb;
+    this->slope = 1.f / std::max(ratio, 1.f) - 1.f;
+    this->makeup = makeupDb;
+    this->knee = std::max(kneeDb, 0.f);
+    this->attack = Dynamics::smoothing(attackMs, this->sampleRate);
+    this->release = Dynamics::smoothing(releaseMs, this->sampleRate);
+  }
+
+  float processSample(float in) {
+    const float over = FastMath::gainToDb(std::fabs(in)) - this->threshold;
+    float target = 0.f;
+    if (2.f * over >= this->knee) {
+      target = this->slope * over;
+    } else if (2.f * over > -this->knee) { // inside the knee, a quadratic from 0 to the slope
+      const float x = over + 0.5f * this->knee;
+      target = this->slope * x * x / (2.f * this->knee);
+    }
+
+    const float coef = target < this->reduction ? this->attack : this->release;
+    this->reduction = target + coef * (this->reduction - target);
+    if (!this->enabled) { return in; }
+    return in * FastMath::dbToGain(this->reduction + this->makeup);
+  }
+};
+
+class FastEnvelopeFilter {
+private:
+  static constexpr float kMinHz = 200.f;
+  static constexpr float kOctaves = 4.f;   // up to 3.2 kHz
+  static constexpr float kRangeDb = 48.f;  // envelope levels from -48 dBFS to 0 cover the sweep
+
+  float sampleRate;
+  float damping = 0.2f; // 1 / Q
+  float attack = 0.f, release = 0.f;
+  float envelope = 0.f;
+  float s1 = 0.f, s2 = 0.f; // the state variable filter's integrators
+  bool enabled = false;
+
+public:
+  explicit FastEnvelopeFilter(int sr) : sampleRate(static_cast<float>(sr)) { this->setParams(); }
+
+  void toggle(bool on) { this->enabled = on; }
+
+  // attack and release in ms
+  void setParams(float q = 5.f, float attackMs = 7.76f, float releaseMs = 1105.f) {
+    this->damping = 1.f / std::max(q, 0.01f);
+    this->attack = Dynamics::smoothing(attackMs, this->sampleRate);
+    this->release = Dynamics::smoothing(releaseMs, this->sampleRate);
+  }
+
+  float processSample(float in) {
+    const float level = std::fabs(in);
+    const float coef = level > this->envelope ? this->attack : this->release;
+    this->envelope = level + coef * (this->envelope - level);
+
+    const float position = std::clamp(FastMath::gainToDb(this->envelope) / kRangeDb + 1.f, 0.f, 1.f);
+    const float hz = std::min(kMinHz * FastMath::exp2(kOctaves * position), 0.45f * this->sampleRate);
+    const float g = FastMath::tan(FastMath::kPi * hz / this->sampleRate);
+
+    // trapezoidal state variable filter, band-pass scaled to unity gain at the centre
+    const float k = this->damping;
+    const float high = (in - (k + g) * this->s1 - this->s2) / (1.f + g * (g + k));
+    const float band = g * high + this->s1;
+    this->s1 = g * high + band;
+    const float low = g * band + this->s2;
+    this->s2 = g * band + low;
+    if (!this->enabled) { return in; }
+    return k * band;
+  }
+};
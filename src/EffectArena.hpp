@@ -0,0 +1,65 @@
+//====================================================================================================
+/* EffectArena.hpp
+
+One contiguous, cache-line aligned block holding every effect instance of the processor. Slots
+reserve their region once (at construction), the block is allocated on the first prepare and
+freed by release(), so re-preparing never touches the heap for the effects themselves.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <juce_core/juce_core.h>
+
+class EffectArena {
+public:
+  static constexpr size_t kAlignment = 64; // cache line, also covers every effect's alignof
+
+private:
+  std::unique_ptr<char[]> storage; // over-allocated by kAlignment - 1 bytes
+  char* block = nullptr;           // the aligned start within storage
+  size_t size = 0;                 // bytes reserved so far
+
+  static std::uintptr_t alignUp(std::uintptr_t n) { return (n + kAlignment - 1) / kAlignment * kAlignment; }
+
+public:
+  EffectArena() {}
+  ~EffectArena() {}
+
+  // Reserves `bytes` and returns their offset. Call before the first allocate()
+  size_t reserve(size_t bytes) {
+    jassert(this->block == nullptr); // the block can't grow once allocated
+    size_t offset = this->size;
+    this->size = alignUp(offset + std::max<size_t>(bytes, 1));
+    return offset;
+  }
+
+  size_t getSize() const { return this->size; }
+  bool isAllocated() const { return this->block != nullptr; }
+
+  // one allocation for everything reserved; a no-op while the block exists
+  void allocate() {
+    if (this->block != nullptr || this->size == 0) { return; }
+    this->storage.reset(new char[this->size + kAlignment - 1]);
+    auto address = reinterpret_cast<std::uintptr_t>(this->storage.get());
+    this->block = this->storage.get() + (alignUp(address) - address);
+    std::fill(this->block, this->block + this->size, 0);
+  }
+
+  // everything placed in the block must have been destroyed first
+  void release() {
+    this->storage.reset();
+    this->block = nullptr;
+  }
+
+  char* data(size_t offset) {
+    this->allocate();
+    jassert(offset < this->size);
+    return this->block + offset;
+  }
+};
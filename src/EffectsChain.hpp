@@ -0,0 +1,687 @@
+//====================================================================================================
+/* EffectsChain.hpp
+
+Block-rate, multichannel wrappers around giml effects. giml::EffectsLine makes one virtual
+processSample() call per effect per sample on a single channel; the classes here hand each
+effect a whole block for every channel instead, and call the concrete processSample() so the
+compiler can inline the inner loop.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+#include "../include/Gimmel/include/gimmel.hpp"
+#include "Parameters.hpp"
+#include "EffectArena.hpp"
+#include "SharedTables.hpp"
+#include "Profiler.hpp"
+
+// Channel layouts accepted by isBusesLayoutSupported: mono or stereo
+constexpr int kMaxChannels = 2;
+
+// Below this a signal counts as silent (-100 dBFS)
+constexpr float kSilenceThreshold = 1.0e-5f;
+
+// Interface class
+class BlockEffect {
+public:
+  // Bypassed stages drop out of the chain's active list; toggling crossfades in or out
+  enum class Bypass { Off, FadingIn, On, FadingOut };
+
+protected:
+  ParameterBundle* params = nullptr;
+  Parameter* enabledParam = nullptr; // the bundle's toggle, if it has one
+  Bypass bypass = Bypass::On;
+  int fadePos = 0;                   // position in the fade table, 0 when bypassed
+  int chainIndex = -1;               // position in the chain's registry, set by pushBack
+
+  // silence tracking, see shouldSleep()
+  std::function<double()> tail;
+  int silentRun = 0;         // samples of silent input since the last sound
+  bool outputSilent = false; // the stage's last output block
+
+  // the last getLatencySamples() of input, see delayInput()
+  std::vector<float> latencyLine[kMaxChannels];
+  int latencyPos = 0;
+
+  void bindBundle(ParameterBundle& bundle) {
+    this->params = &bundle;
+    this->enabledParam = nullptr;
+    for (auto& p : bundle) {
+      if (p->isToggle()) { this->enabledParam = p; }
+    }
+  }
+
+public:
+  BlockEffect() {}
+  virtual ~BlockEffect() {}
+
+  // `in` and `out` may point to the same buffers
+  virtual void processBlock(const float* const* in, float* const* out, int numChannels, int numSamples) = 0;
+
+  // pushes the bound parameters' values `offset` samples into the block to the effect
+  virtual void updateParams(int offset) { juce::ignoreUnused(offset); }
+
+  // delay the stage adds to its output, e.g. oversampling filters
+  virtual int getLatencySamples() const { return 0; }
+
+  ParameterBundle* getParams() { return this->params; }
+  int getChainIndex() const { return this->chainIndex; }
+  void setChainIndex(int index) { this->chainIndex = index; }
+  Bypass getBypass() const { return this->bypass; }
+  bool isActive() const { return this->bypass != Bypass::Off; }
+
+  // Audio thread: active, or switched on by the last poll or program assign. A stage that
+  // needs modulation needs it in the block its fade-in starts
+  bool isEnabled() const { return this->isActive() || (this->enabledParam != nullptr && this->enabledParam->isOn()); }
+
+  // the toggle's value in the treeState, for the message thread
+  bool isSwitchedOn() const { return this->enabledParam == nullptr || this->enabledParam->load() >= 0.5f; }
+
+  //==============================================================================
+  // Tails and silence
+
+  // Time for a line of `period` seconds recirculating at `gain` to decay below kSilenceThreshold.
+  // Infinite once the feedback stops decaying
+  static double ringTime(double period, double gain) {
+    const double g = std::abs(gain);
+    if (g >= 0.9999) { return std::numeric_limits<double>::infinity(); }
+    if (g <= 0.0) { return period; }
+    return period * (1.0 + std::log(static_cast<double>(kSilenceThreshold)) / std::log(g));
+  }
+
+  // `fn` returns how long the stage keeps sounding after its input stops, in seconds. It's
+  // called from both threads, so it should read parameters with load()
+  void setTail(std::function<double()> fn) { this->tail = std::move(fn); }
+
+  // seconds, including the latency the stage adds
+  double getTailSeconds(double sampleRate) const {
+    const double latency = sampleRate > 0.0 ? this->getLatencySamples() / sampleRate : 0.0;
+    return (this->tail ? this->tail() : 0.0) + latency;
+  }
+
+  // Audio thread, once per block. True if the stage can skip the block and write zeros: its
+  // input has been silent for longer than its tail and its own output has gone silent too.
+  // A sleeping stage keeps its (decayed) state and picks up parameter changes when it wakes
+  bool shouldSleep(bool inputSilent, int numSamples, double sampleRate) {
+    if (!inputSilent) {
+      this->silentRun = 0;
+      return false;
+    }
+    const double tailSamples = std::ceil(this->getTailSeconds(sampleRate) * sampleRate);
+    const bool asleep = this->outputSilent && static_cast<double>(this->silentRun) >= tailSamples;
+    this->silentRun = std::min(this->silentRun, INT_MAX - numSamples) + numSamples;
+    return asleep;
+  }
+
+  void setOutputSilent(bool silent) { this->outputSilent = silent; }
+
+  // forget the silence so far, e.g. after the stage is rebuilt
+  void wake() {
+    this->silentRun = 0;
+    this->outputSilent = false;
+  }
+
+  //==============================================================================
+  // Latency while bypassed
+
+  // sizes the delay line to the stage's current latency and clears it. Not real-time safe
+  void prepareLatencyLine() {
+    for (auto& line : this->latencyLine) {
+      line.assign(static_cast<size_t>(std::max(this->getLatencySamples(), 0)), 0.f);
+    }
+    this->latencyPos = 0;
+  }
+
+  // Writes `in` delayed by the stage's latency to `out` (which may be `in`), the path that
+  // stands in for the stage while it's bypassed or crossfading, so its place in the line always
+  // delays by the same amount. With `out` null it only records the input
+  void delayInput(const float* const* in, float* const* out, int numChannels, int numSamples) {
+    const int size = static_cast<int>(this->latencyLine[0].size());
+    if (size == 0) {
+      for (int ch = 0; out != nullptr && ch < numChannels; ch++) {
+        if (in[ch] != out[ch]) { std::copy(in[ch], in[ch] + numSamples, out[ch]); }
+      }
+      return;
+    }
+
+    int pos = this->latencyPos;
+    for (int ch = 0; ch < numChannels; ch++) {
+      float* line = this->latencyLine[ch].data();
+      pos = this->latencyPos;
+      for (int i = 0; i < numSamples; i++) {
+        const float x = in[ch][i];
+        if (out != nullptr) { out[ch][i] = line[pos]; }
+        line[pos] = x;
+        if (++pos == size) { pos = 0; }
+      }
+    }
+    this->latencyPos = pos;
+  }
+
+  // Reads the toggle and starts a crossfade when it flips.
+  // Returns true if the stage joined or left the active list
+  bool pollEnabled() {
+    if (this->enabledParam == nullptr || !this->enabledParam->poll()) { return false; }
+
+    bool wasActive = this->isActive();
+    if (this->enabledParam->isOn()) {
+      if (this->bypass == Bypass::Off) { this->params->markDirty(); } // setters were skipped while off
+      if (this->bypass != Bypass::On) { this->bypass = Bypass::FadingIn; }
+    } else if (this->bypass != Bypass::Off) {
+      this->bypass = Bypass::FadingOut;
+    }
+    return this->isActive() != wasActive;
+  }
+
+  // jumps straight to the toggle's current state, no crossfade
+  void resetBypass(int fadeLength) {
+    bool on = true;
+    if (this->enabledParam != nullptr) {
+      this->enabledParam->poll();
+      on = this->enabledParam->isOn();
+    }
+    this->bypass = on ? Bypass::On : Bypass::Off;
+    this->fadePos = on ? fadeLength : 0;
+  }
+
+  // Equal-power mix of the stage's input (`dry`) into its output while fading. `gains` is the
+  // shared fade table (fadeLength + 1 entries), read forwards for wet and backwards for dry.
+  // Returns true once a fade-out completes and the stage should leave the active list
+  bool applyCrossfade(const float* const* dry, float* const* out, int numChannels, int numSamples,
+                      const float* gains, int fadeLength) {
+    const int direction = this->bypass == Bypass::FadingIn ? 1 : -1;
+    int pos = this->fadePos;
+    for (int i = 0; i < numSamples; i++) {
+      pos = juce::jlimit(0, fadeLength, pos + direction);
+      const float wetGain = gains[pos];
+      const float dryGain = gains[fadeLength - pos];
+      for (int ch = 0; ch < numChannels; ch++) {
+        out[ch][i] = dry[ch][i] * dryGain + out[ch][i] * wetGain;
+      }
+    }
+    this->fadePos = pos;
+
+    if (pos >= fadeLength) { this->bypass = Bypass::On; }
+    if (pos <= 0) { this->bypass = Bypass::Off; return true; }
+    return false;
+  }
+};
+
+// Owns one instance of a giml effect per channel so every channel keeps its own state.
+// The qualified call to Fx::processSample bypasses the vtable, so the chain pays one virtual
+// call per block instead of per sample.
+// Instances are placed in an EffectArena; slots without one get a private arena on first use.
+template <class Fx>
+class EffectSlot : public BlockEffect {
+private:
+  Fx* lanes[kMaxChannels] = {};
+  int numLanes = 0;
+  std::function<void(Fx&, int)> setter;
+
+  EffectArena* arena = nullptr;
+  size_t arenaOffset = 0;
+  std::unique_ptr<EffectArena> ownArena;
+
+  static void processLane(Fx& fx, const float* in, float* out, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      out[i] = fx.Fx::processSample(in[i]);
+    }
+  }
+
+public:
+  EffectSlot() {}
+  ~EffectSlot() { this->release(); }
+
+  // reserves room for kMaxChannels instances; call before the arena is allocated
+  void placeIn(EffectArena& a) {
+    static_assert(alignof(Fx) <= EffectArena::kAlignment, "arena regions are only cache-line aligned");
+    this->arena = &a;
+    this->arenaOffset = a.reserve(sizeof(Fx) * kMaxChannels);
+  }
+
+  // Builds the instances, fresh on every call: hosts re-prepare on transport resets and expect
+  // no old tails or envelopes after. giml effects have no reset, so even at the same rate and
+  // channel count each lane is rebuilt, in its place in the arena
+  void prepare(int sampleRate, int numChannels) {
+    const int wanted = std::max(1, std::min(numChannels, kMaxChannels));
+    this->release();
+    if (this->arena == nullptr) {
+      this->ownArena = std::make_unique<EffectArena>();
+      this->placeIn(*this->ownArena);
+    }
+    char* storage = this->arena->data(this->arenaOffset);
+    for (int ch = 0; ch < wanted; ch++) {
+      this->lanes[ch] = new (storage + ch * sizeof(Fx)) Fx(sampleRate);
+      this->lanes[ch]->toggle(true); // bypass is handled by the chain
+    }
+    this->numLanes = wanted;
+  }
+
+  // destroys the instances; the arena block itself is freed by its owner
+  void release() {
+    for (auto& lane : this->lanes) {
+      if (lane != nullptr) {
+        lane->~Fx();
+        lane = nullptr;
+      }
+    }
+    this->numLanes = 0;
+  }
+
+  int getNumLanes() const { return this->numLanes; }
+  Fx& operator[](int channel) { return *this->lanes[channel]; }
+
+  // apply a setter (toggle, setParams, ...) to every channel's instance
+  template <typename Fn>
+  void forEachLane(Fn&& fn) {
+    for (int ch = 0; ch < this->numLanes; ch++) {
+      fn(*this->lanes[ch]);
+    }
+  }
+
+  // `fn(fx, offset)` pushes the bundle's values at `offset` into one channel's instance
+  void bindParams(ParameterBundle& bundle, std::function<void(Fx&, int)> fn) {
+    this->bindBundle(bundle);
+    this->setter = std::move(fn);
+  }
+
+  void updateParams(int offset) override {
+    if (!this->setter) { return; }
+    for (int ch = 0; ch < this->numLanes; ch++) {
+      this->setter(*this->lanes[ch], offset);
+    }
+  }
+
+  void processBlock(const float* const* in, float* const* out, int numChannels, int numSamples) override {
+    int numActive = std::min(numChannels, this->numLanes);
+
+    if (numActive == 2) {
+      // Stereo runs both lanes interleaved in a single loop: the two channels are
+      // independent recurrences, so the CPU overlaps them instead of running two passes
+      Fx& left = *this->lanes[0];
+      Fx& right = *this->lanes[1];
+      const float* inL = in[0];
+      const float* inR = in[1];
+      float* outL = out[0];
+      float* outR = out[1];
+      for (int i = 0; i < numSamples; i++) {
+        outL[i] = left.Fx::processSample(inL[i]);
+        outR[i] = right.Fx::processSample(inR[i]);
+      }
+    } else {
+      for (int ch = 0; ch < numActive; ch++) {
+        processLane(*this->lanes[ch], in[ch], out[ch], numSamples);
+      }
+    }
+
+    // channels without a lane pass through
+    for (int ch = numActive; ch < numChannels; ch++) {
+      if (in[ch] != out[ch]) { std::copy(in[ch], in[ch] + numSamples, out[ch]); }
+    }
+  }
+};
+
+// One arrangement of the line, built on the message thread and read by the audio thread
+struct ChainOrder {
+  std::vector<BlockEffect*> stages;
+  int latency = 0;       // sum of the stages' latency, what the host is told
+  uint64_t sequence = 0; // publication order, see EffectsChain::collectGarbage
+};
+
+class EffectsChain {
+private:
+  std::vector<BlockEffect*> stages;      // every registered effect, in pushBack order
+  std::vector<BlockEffect*> active;      // stages in the current order that run: not bypassed, or with latency
+  std::vector<float> dry[kMaxChannels];  // a stage's input, kept while it crossfades
+  int maxBlockSize = 0;
+  double sampleRate = 0.0;
+  juce::int64 position = 0; // samples since prepare, places the control grid
+  SharedTable fadeTable; // equal-power gains over kFadeMs, shared by every instance at this rate
+  int fadeLength = 1;
+
+  static constexpr double kFadeMs = 10.0;
+
+  // Orders are published with an atomic pointer swap. The message thread owns every order it
+  // has built; the audio thread takes the pending one with an exchange, then acknowledges its
+  // sequence number once it has let go of the order before
+  std::vector<std::unique_ptr<ChainOrder>> orders;
+  std::atomic<ChainOrder*> pending { nullptr };
+  std::atomic<uint64_t> acknowledged { 0 };
+  uint64_t lastSequence = 0;
+  ChainOrder* current = nullptr;  // audio thread's order
+  std::vector<int> requestedOrder; // indices into stages, kept across re-prepares
+  std::atomic<double> tailSeconds { 0.0 }; // of the requested order, see updateTail()
+  bool hasRequestedOrder = false;  // an empty requested order is a valid (empty) line
+
+#if GIMMEL_PROFILE
+  ChainProfiler* profiler = nullptr;
+#endif
+
+  static void updateLatency(ChainOrder& order) {
+    order.latency = 0;
+    for (auto* stage : order.stages) { order.latency += stage->getLatencySamples(); }
+  }
+
+  std::unique_ptr<ChainOrder> makeOrder(const std::vector<int>& indices) {
+    auto order = std::make_unique<ChainOrder>();
+    order->sequence = ++this->lastSequence;
+    for (int i : indices) {
+      if (i < 0 || i >= this->size()) { continue; }
+      BlockEffect* stage = this->stages[static_cast<size_t>(i)];
+      // each effect appears at most once, its state can't run in two places
+      if (std::find(order->stages.begin(), order->stages.end(), stage) == order->stages.end()) {
+        order->stages.push_back(stage);
+        order->latency += stage->getLatencySamples();
+      }
+    }
+    return order;
+  }
+
+  // Message thread: free the orders the audio thread has moved past. Sequence numbers only
+  // grow, so anything older than the acknowledged order can't be in use or pending; the order
+  // being adopted right now is newer and stays
+  void collectGarbage() {
+    const uint64_t seen = this->acknowledged.load(std::memory_order_acquire);
+    this->orders.erase(std::remove_if(this->orders.begin(), this->orders.end(),
+                                      [seen](const std::unique_ptr<ChainOrder>& o) { return o->sequence < seen; }),
+                       this->orders.end());
+  }
+
+  // message thread: an order taken back out of `pending` was never seen by the audio thread
+  void dropOrder(ChainOrder* order) {
+    this->orders.erase(std::remove_if(this->orders.begin(), this->orders.end(),
+                                      [order](const std::unique_ptr<ChainOrder>& o) { return o.get() == order; }),
+                       this->orders.end());
+  }
+
+  // audio thread: switch to a newly published order. Stages carry their state across
+  bool adoptPendingOrder() {
+    ChainOrder* next = this->pending.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr) { return false; }
+    this->current = next;
+    this->acknowledged.store(next->sequence, std::memory_order_release);
+    return true;
+  }
+
+  // calls fn(stage) once for every stage of the requested order, in order
+  template <typename Fn>
+  void forEachRequested(Fn&& fn) const {
+    if (!this->hasRequestedOrder) {
+      for (auto* stage : this->stages) { fn(*stage); }
+      return;
+    }
+    const auto& order = this->requestedOrder;
+    for (auto it = order.begin(); it != order.end(); ++it) {
+      if (*it < 0 || *it >= this->size() || std::find(order.begin(), it, *it) != it) { continue; }
+      fn(*this->stages[static_cast<size_t>(*it)]);
+    }
+  }
+
+  std::vector<int> defaultOrder() const {
+    std::vector<int> indices;
+    for (int i = 0; i < this->size(); i++) { indices.push_back(i); }
+    return indices;
+  }
+
+  // While any of a stage's parameters is ramping, its values are pushed to the effect
+  // every kControlInterval samples; settled stages run the whole block in one pass. The
+  // updates sit on a grid counted from prepare, not from the block, so they land on the
+  // same samples whatever the host's block size
+  static constexpr int kControlInterval = 32;
+
+  void processStage(BlockEffect& stage, const float* const* in, float* const* out, int numChannels, int numSamples) const {
+    ParameterBundle* params = stage.getParams();
+    if (params == nullptr) {
+      stage.processBlock(in, out, numChannels, numSamples);
+      return;
+    }
+
+    bool changed = params->poll();
+    if (!params->renderRamps(numSamples)) {
+      if (changed) { stage.updateParams(0); }
+      stage.processBlock(in, out, numChannels, numSamples);
+      return;
+    }
+
+    jassert(numChannels <= kMaxChannels);
+    const float* inSub[kMaxChannels];
+    float* outSub[kMaxChannels];
+    const int phase = static_cast<int>(this->position % kControlInterval);
+    for (int start = 0, length = 0; start < numSamples; start += length) {
+      length = std::min(kControlInterval - (start == 0 ? phase : 0), numSamples - start);
+      for (int ch = 0; ch < numChannels; ch++) {
+        inSub[ch] = in[ch] + start;
+        outSub[ch] = out[ch] + start;
+      }
+      stage.updateParams(start);
+      stage.processBlock(inSub, outSub, numChannels, length);
+    }
+  }
+
+  // Runs a stage that is fading in or out. The dry side is delayed by the stage's latency, so
+  // it lines up with the wet side. Returns true if it finished fading out
+  bool processCrossfade(BlockEffect& stage, const float* const* in, float* const* out, int numChannels, int numSamples) {
+    const float* dryChannels[kMaxChannels];
+    float* dryWrite[kMaxChannels];
+    for (int ch = 0; ch < numChannels; ch++) {
+      dryWrite[ch] = this->dry[ch].data();
+      dryChannels[ch] = dryWrite[ch];
+    }
+    stage.delayInput(in, dryWrite, numChannels, numSamples);
+    processStage(stage, in, out, numChannels, numSamples);
+    return stage.applyCrossfade(dryChannels, out, numChannels, numSamples, this->fadeTable->data(), this->fadeLength);
+  }
+
+  // A bypassed stage with latency stays in the line as a plain delay of that latency: the
+  // output keeps the delay the host compensates for, and nothing jumps when it's toggled
+  void rebuildActive() {
+    this->active.clear(); // capacity is reserved in pushBack, so no allocation here
+    if (this->current == nullptr) { return; }
+    for (auto* stage : this->current->stages) {
+      if (stage->isActive() || stage->getLatencySamples() > 0) { this->active.push_back(stage); }
+    }
+  }
+
+  static bool isSilent(const float* const* buffers, int numChannels, int numSamples) {
+    for (int ch = 0; ch < numChannels; ch++) {
+      const float* x = buffers[ch];
+      for (int i = 0; i < numSamples; i++) {
+        if (std::abs(x[i]) > kSilenceThreshold) { return false; }
+      }
+    }
+    return true;
+  }
+
+  void processChunk(const float* const* in, float* const* out, int numChannels, int numSamples) {
+    if (this->active.empty()) {
+      for (int ch = 0; ch < numChannels; ch++) {
+        if (in[ch] != out[ch]) { std::copy(in[ch], in[ch] + numSamples, out[ch]); }
+      }
+      return;
+    }
+
+    // Silence is tracked down the line: a stage whose input and tail have died out writes
+    // zeros instead of running, so an idle chain costs one scan of its input per block
+    bool faded = false;
+    bool silent = isSilent(in, numChannels, numSamples);
+    const float* const* src = in;
+    for (auto* stage : this->active) {
+      GIMMEL_PROFILE_STAGE(this->profiler, stage->getChainIndex());
+      if (stage->getBypass() == BlockEffect::Bypass::Off) {
+        stage->delayInput(src, out, numChannels, numSamples);
+        silent = isSilent(out, numChannels, numSamples);
+        src = out;
+        continue;
+      }
+
+      const bool sleep = stage->shouldSleep(silent, numSamples, this->sampleRate);
+      if (stage->getBypass() == BlockEffect::Bypass::On) {
+        stage->delayInput(src, nullptr, numChannels, numSamples); // the dry side of a later fade-out
+        if (sleep) {
+          for (int ch = 0; ch < numChannels; ch++) { std::fill(out[ch], out[ch] + numSamples, 0.f); }
+          src = out;
+          continue;
+        }
+        processStage(*stage, src, out, numChannels, numSamples);
+      } else {
+        faded |= this->processCrossfade(*stage, src, out, numChannels, numSamples);
+      }
+      silent = isSilent(out, numChannels, numSamples);
+      stage->setOutputSilent(silent);
+      src = out;
+    }
+    if (faded) { this->rebuildActive(); }
+  }
+
+public:
+  EffectsChain() {}
+  ~EffectsChain() {}
+
+  void pushBack(BlockEffect* effect) {
+    effect->setChainIndex(this->size());
+    this->stages.push_back(effect);
+    this->active.reserve(this->stages.size());
+  }
+
+  // not real-time safe, only call while the audio thread is stopped (e.g. in prepareToPlay)
+  void clear() {
+    this->stages.clear();
+    this->active.clear();
+    this->current = nullptr;
+    this->pending.store(nullptr);
+    this->acknowledged.store(0);
+    this->orders.clear();
+  }
+
+  int size() const { return static_cast<int>(this->stages.size()); }
+
+#if GIMMEL_PROFILE
+  // times every stage into `p`, which must outlive the chain's processing
+  void setProfiler(ChainProfiler* p) { this->profiler = p; }
+#endif
+
+  // Message thread: reorder, add or remove effects while audio runs. `indices` refer to
+  // pushBack order; effects left out are removed from the line but keep their state
+  void setOrder(const std::vector<int>& indices) {
+    this->requestedOrder = indices;
+    this->hasRequestedOrder = true;
+    if (this->stages.empty()) { return; } // applied by the next prepare
+
+    auto order = this->makeOrder(indices);
+    ChainOrder* published = order.get();
+    this->orders.push_back(std::move(order));
+    if (ChainOrder* unseen = this->pending.exchange(published)) { this->dropOrder(unseen); }
+    this->collectGarbage();
+    this->updateTail();
+  }
+
+  std::vector<int> getOrder() const {
+    return this->hasRequestedOrder ? this->requestedOrder : this->defaultOrder();
+  }
+
+  // Message thread: recomputes how long the requested order keeps sounding after its input
+  // stops. The chain calls it when the order or a stage changes, the owner after parameter
+  // changes. The stages are in series, so their tails add; bypassed stages don't count
+  void updateTail() {
+    double seconds = 0.0;
+    this->forEachRequested([&](const BlockEffect& stage) {
+      if (stage.isSwitchedOn()) { seconds += stage.getTailSeconds(this->sampleRate); }
+    });
+    this->tailSeconds.store(seconds);
+  }
+
+  // the last updateTail(), for any thread
+  double getTailSeconds() const { return this->tailSeconds.load(); }
+
+  // latency of the requested order, for setLatencySamples on the message thread
+  int getLatencySamples() const {
+    int latency = 0;
+    this->forEachRequested([&](const BlockEffect& stage) { latency += stage.getLatencySamples(); });
+    return latency;
+  }
+
+  // Call after the stages are pushed and prepared. Repeated calls with the same settings
+  // reuse the order and buffers, nothing is allocated
+  void prepare(double sampleRate, int blockSize) {
+    if (ChainOrder* published = this->pending.exchange(nullptr)) { this->current = published; }
+    if (this->current == nullptr) {
+      this->orders.push_back(this->makeOrder(this->getOrder()));
+      this->current = this->orders.back().get();
+    }
+    updateLatency(*this->current); // stages' latency may have changed with their settings
+    this->acknowledged.store(this->current->sequence);
+    this->collectGarbage();
+
+    this->maxBlockSize = std::max(blockSize, 1);
+    this->sampleRate = sampleRate;
+    for (auto& channel : this->dry) {
+      channel.assign(static_cast<size_t>(this->maxBlockSize), 0.f);
+    }
+    this->fadeTable = SharedTables::equalPowerFade(sampleRate, kFadeMs);
+    this->fadeLength = static_cast<int>(this->fadeTable->size()) - 1;
+
+    for (auto* stage : this->stages) {
+      stage->prepareLatencyLine();
+      stage->resetBypass(this->fadeLength);
+      stage->wake();
+    }
+    this->rebuildActive();
+    this->updateTail();
+    this->position = 0;
+  }
+
+  // Audio thread stopped: `stage` was rebuilt with a different latency (e.g. an oversampling
+  // factor). Updates every order's latency and the stage's delay line, leaves the rest alone
+  void stageChanged(BlockEffect& stage) {
+    for (auto& order : this->orders) { updateLatency(*order); }
+    stage.prepareLatencyLine();
+    stage.resetBypass(this->fadeLength);
+    stage.wake();
+    this->rebuildActive();
+    this->updateTail();
+  }
+
+  // Bypassed effects cost nothing beyond a toggle check per block; enabled ones run one
+  // pass over the whole block, in place after the first stage
+  void processBlock(const float* const* in, float* const* out, int numChannels, int numSamples) {
+    bool changed = this->adoptPendingOrder();
+    if (this->current != nullptr) {
+      for (auto* stage : this->current->stages) {
+        changed |= stage->pollEnabled();
+      }
+    }
+    if (changed) { this->rebuildActive(); }
+
+    // hosts may send blocks larger than the size they prepared with
+    if (numSamples <= this->maxBlockSize) {
+      this->processChunk(in, out, numChannels, numSamples);
+      this->position += numSamples;
+      return;
+    }
+
+    jassert(numChannels <= kMaxChannels);
+    const float* inSub[kMaxChannels];
+    float* outSub[kMaxChannels];
+    for (int start = 0; start < numSamples; start += this->maxBlockSize) {
+      int length = std::min(this->maxBlockSize, numSamples - start);
+      for (int ch = 0; ch < numChannels; ch++) {
+        inSub[ch] = in[ch] + start;
+        outSub[ch] = out[ch] + start;
+      }
+      this->processChunk(inSub, outSub, numChannels, length);
+      this->position += length;
+    }
+  }
+};
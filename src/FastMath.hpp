@@ -0,0 +1,206 @@
+//====================================================================================================
+/* FastMath.hpp
+
+Approximations of the transcendental functions our hot paths call per sample or per bin:
+dB <-> gain, exp2/log2, sin/cos, tan and tanh. Each comes in three accuracy tiers, picked at
+compile time with GIMMEL_FAST_MATH (cmake -DGIMMEL_FAST_MATH=0/1/2):
+
+  0  Exact    the std:: functions
+  1  Precise  ~1e-5 (the default)
+  2  Fast     ~1e-3
+
+The kernels are branch-free polynomials with bit-level range reduction, so a plain loop over
+one of them vectorizes. The coefficients are minimax fits of the relative error on the reduced
+range, and the reductions keep it near 0 as well: exp2(0) and dbToGain(0) are exactly 1,
+log2(1), sin(0) and tanh(0) exactly 0, and tanh is odd. GIMMEL-BENCH reports each tier's
+measured error and speed. Callers can also ask for a tier explicitly, e.g.
+FastMath::sin<FastMath::Tier::Fast>(x).
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifndef GIMMEL_FAST_MATH
+  #define GIMMEL_FAST_MATH 1
+#endif
+
+namespace FastMath {
+  enum class Tier { Exact = 0, Precise = 1, Fast = 2 };
+  constexpr Tier kTier = static_cast<Tier>(GIMMEL_FAST_MATH);
+  static_assert(GIMMEL_FAST_MATH >= 0 && GIMMEL_FAST_MATH <= 2, "GIMMEL_FAST_MATH is 0, 1 or 2");
+
+  constexpr float kPi = 3.14159265358979f;
+  constexpr float kTwoPi = 6.28318530717959f;
+  constexpr float kLog2OfTen = 3.32192809488736f;
+
+  namespace detail {
+    inline int32_t bits(float x) { int32_t i; std::memcpy(&i, &x, sizeof(i)); return i; }
+    inline float fromBits(int32_t i) { float x; std::memcpy(&x, &i, sizeof(x)); return x; }
+
+    // c ? a : b as a bit mask. GCC turns a ternary or std::min/max against a constant back into
+    // a branch (the rest of the kernel folds on the constant side), which stops vectorization
+    inline float select(bool c, float a, float b) {
+      const int32_t mask = -static_cast<int32_t>(c);
+      return fromBits((bits(a) & mask) | (bits(b) & ~mask));
+    }
+    inline float clamp(float x, float lo, float hi) { return select(x > hi, hi, select(x < lo, lo, x)); }
+
+    // Rounds x to the nearest integer, returned as a float in `whole` and as an int. Adding
+    // 1.5 * 2^23 leaves the integer in the low mantissa bits, which costs two adds instead of
+    // float <-> int conversions and vectorizes. Needs |x| < 2^22 and IEEE arithmetic (no
+    // -ffast-math, which folds the add and subtract away)
+    inline int roundToInt(float x, float& whole) {
+      const float t = x + 12582912.f;
+      whole = t - 12582912.f;
+      return bits(t) - 0x4b400000;
+    }
+
+    // flips x's sign when k is odd
+    inline float flipIfOdd(float x, int k) {
+      return fromBits(bits(x) ^ static_cast<int32_t>(static_cast<uint32_t>(k) << 31));
+    }
+
+    // sin(r) for r in [-pi/2, pi/2], an odd polynomial. Callers reduce to that range around the
+    // nearest root, so results near a root keep their relative accuracy
+    template <Tier T>
+    inline float sinHalfPi(float r) {
+      const float s = r * r;
+      if constexpr (T == Tier::Precise) {
+        return r * (0.999999237f + s * (-0.166656765f + s * (0.00831319141f + s * -0.000185225393f)));
+      } else {
+        return r * (0.999911528f + s * (-0.166020004f + s * 0.00762666215f));
+      }
+    }
+
+    // x - m (pi / 2) in three parts (Cody-Waite), exact enough for |m| in the thousands
+    inline float minusHalfPis(float x, float m) {
+      return ((x - m * 1.5703125f) - m * 4.837512969970703125e-4f) - m * 7.54978995489188216e-8f;
+    }
+  } // namespace detail
+
+  template <Tier T = kTier>
+  inline float exp2(float x) {
+    if constexpr (T == Tier::Exact) {
+      return std::exp2(x);
+    } else {
+      x = detail::clamp(x, -126.f, 127.f);
+      float whole;
+      const int i = detail::roundToInt(x, whole);
+      const float f = x - whole; // in [-0.5, 0.5]
+      float p;
+      // fits with p(0) = 1 held exactly, so exp2 of an integer is exact, and p(0.5) = 2 p(-0.5)
+      // so the pieces either side of a half meet
+      if constexpr (T == Tier::Precise) {
+        p = 1.f + f * (0.693116843f + f * (0.24022978f + f * (0.055962662f + f * 0.0096610839f)));
+      } else {
+        p = 1.f + f * (0.693282927f + f * (0.242210959f + f * 0.0550089307f));
+      }
+      return p * detail::fromBits((i + 127) << 23);
+    }
+  }
+
+  // x <= 0 gives log2 of the smallest normal float, -126
+  template <Tier T = kTier>
+  inline float log2(float x) {
+    if constexpr (T == Tier::Exact) {
+      return std::log2(x);
+    } else {
+      // mantissas from sqrt(2) up count as half of one more octave, so u is centred on 0 and
+      // log2 keeps its relative accuracy either side of 1
+      const int32_t b = detail::bits(detail::select(x < 1.17549435e-38f, 1.17549435e-38f, x)) - 0x3f3504f3;
+      const float e = static_cast<float>(b >> 23);
+      const float u = detail::fromBits((b & 0x7fffff) + 0x3f3504f3) - 1.f; // in [sqrt(0.5) - 1, sqrt(2) - 1)
+      float q;
+      if constexpr (T == Tier::Precise) {
+        q = 1.44270162f + u * (-0.72120639f + u * (0.479811857f + u * (-0.366491712f + u * (0.318199892f + u * -0.206190997f))));
+      } else {
+        q = 1.44227043f + u * (-0.72429696f + u * (0.511272725f + u * -0.327770689f));
+      }
+      return e + u * q;
+    }
+  }
+
+  template <Tier T = kTier>
+  inline float dbToGain(float db) { return exp2<T>(db * (kLog2OfTen / 20.f)); }
+
+  template <Tier T = kTier>
+  inline float gainToDb(float gain) { return log2<T>(gain) * (20.f / kLog2OfTen); }
+
+  // sin(2 pi t), t in cycles: the LFO's form, with no multiply by 2 pi to undo. t less the
+  // nearest half cycle is exact, so the result is accurate near every root
+  template <Tier T = kTier>
+  inline float sinCycles(float t) {
+    if constexpr (T == Tier::Exact) {
+      return static_cast<float>(std::sin(6.283185307179586 * t));
+    } else {
+      float whole;
+      const int k = detail::roundToInt(2.f * t, whole);
+      return detail::flipIfOdd(detail::sinHalfPi<T>(kTwoPi * (t - 0.5f * whole)), k);
+    }
+  }
+
+  // accurate to the tier for |x| up to a few thousand radians
+  template <Tier T = kTier>
+  inline float sin(float x) {
+    if constexpr (T == Tier::Exact) {
+      return std::sin(x);
+    } else {
+      float whole;
+      const int k = detail::roundToInt(x * (1.f / kPi), whole); // x = k pi + r
+      return detail::flipIfOdd(detail::sinHalfPi<T>(detail::minusHalfPis(x, 2.f * whole)), k);
+    }
+  }
+
+  template <Tier T = kTier>
+  inline float cos(float x) {
+    if constexpr (T == Tier::Exact) {
+      return std::cos(x);
+    } else {
+      float whole;
+      const int k = detail::roundToInt(x * (1.f / kPi) - 0.5f, whole); // x = (k + 1/2) pi + r, cos(x) = -(-1)^k sin(r)
+      return detail::flipIfOdd(detail::sinHalfPi<T>(detail::minusHalfPis(x, 2.f * whole + 1.f)), k + 1);
+    }
+  }
+
+  // relative error grows near the poles
+  template <Tier T = kTier>
+  inline float tan(float x) {
+    if constexpr (T == Tier::Exact) {
+      return std::tan(x);
+    } else {
+      // tan has period pi: one reduction to r in [-pi/2, pi/2], then sin(r) / cos(r) with
+      // cos(r) = sin(pi/2 - |r|)
+      float whole;
+      detail::roundToInt(x * (1.f / kPi), whole);
+      const float r = detail::minusHalfPis(x, 2.f * whole);
+      const float c = (1.5703125f - std::fabs(r)) + 4.837512969970703125e-4f + 7.54978995489188216e-8f;
+      return detail::sinHalfPi<T>(r) / detail::sinHalfPi<T>(c);
+    }
+  }
+
+  template <Tier T = kTier>
+  inline float tanh(float x) {
+    if constexpr (T == Tier::Exact) {
+      return std::tanh(x);
+    } else {
+      // odd by construction: 1 - 2 / (e^(2|x|) + 1) with x's sign, and below |x| = 0.5, where
+      // that cancels, an odd polynomial
+      const float a = std::fabs(x);
+      const float e = exp2<T>(detail::select(a > 9.f, 9.f, a) * 2.88539008f); // tanh is 1 to float precision beyond 9
+      const float large = std::copysign(1.f - 2.f / (e + 1.f), x);
+      const float s = x * x;
+      float small;
+      if constexpr (T == Tier::Precise) {
+        small = x + x * s * (-0.333281593f + s * (0.132053597f + s * -0.0447506448f));
+      } else {
+        small = x + x * s * (-0.332069152f + s * 0.116440598f);
+      }
+      return detail::select(a < 0.5f, small, large);
+    }
+  }
+} // namespace FastMath
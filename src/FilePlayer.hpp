@@ -0,0 +1,162 @@
+//====================================================================================================
+/* FilePlayer.hpp
+
+Loops an audio file as a test signal in place of the live input. WAV files are memory-mapped
+(other formats are streamed); a read-ahead thread converts the file to the host rate with a
+Lagrange interpolator and keeps a LockFreeRing of stereo frames topped up, so the audio thread
+only copies frames out of the ring.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "LockFreeRing.hpp"
+
+class FilePlayer : private juce::Thread {
+private:
+  struct Frame {
+    float left, right;
+  };
+
+  // sized once so load() and prepare() never reallocate under the audio thread:
+  // ~0.7 s at 192 kHz, far more than the thread's wake-up interval
+  static constexpr int kCapacity = 1 << 17;
+  static constexpr int kChunk = 1024; // output frames rendered per pass
+
+  LockFreeRing<Frame> ring;
+  std::unique_ptr<juce::AudioFormatReader> reader; // only touched while the thread is stopped or by the thread
+  juce::String fileName;
+
+  std::atomic<double> hostRate { 0.0 };
+  std::atomic<bool> flushPending { false }; // set by load(), cleared by the audio thread
+
+  // read-ahead thread state
+  juce::LagrangeInterpolator interpolators[2];
+  juce::AudioBuffer<float> fileBuffer;   // file-rate samples for one pass
+  juce::AudioBuffer<float> outputBuffer; // host-rate samples for one pass
+  juce::int64 readPosition = 0;
+  double ratio = 0.0; // file samples per host sample
+
+  // reads `numSamples` from the file at readPosition onwards, wrapping at the end
+  void readLooped(int numSamples) {
+    const juce::int64 length = this->reader->lengthInSamples;
+    const bool stereo = this->reader->numChannels > 1;
+    int done = 0;
+    while (done < numSamples) {
+      juce::int64 pos = (this->readPosition + done) % length;
+      int n = static_cast<int>(std::min<juce::int64>(numSamples - done, length - pos));
+      this->reader->read(&this->fileBuffer, done, n, pos, true, stereo);
+      done += n;
+    }
+    if (!stereo) { this->fileBuffer.copyFrom(1, 0, this->fileBuffer, 0, 0, numSamples); }
+  }
+
+  void renderChunk() {
+    // a few extra samples of lookahead for the interpolator
+    const int needed = static_cast<int>(std::ceil(kChunk * this->ratio)) + 4;
+    if (this->fileBuffer.getNumSamples() < needed) { this->fileBuffer.setSize(2, needed); }
+    this->readLooped(needed);
+
+    int used = 0;
+    for (int ch = 0; ch < 2; ch++) {
+      used = this->interpolators[ch].process(this->ratio, this->fileBuffer.getReadPointer(ch),
+                                             this->outputBuffer.getWritePointer(ch), kChunk);
+    }
+    this->readPosition = (this->readPosition + used) % this->reader->lengthInSamples;
+
+    Frame frames[kChunk];
+    const float* left = this->outputBuffer.getReadPointer(0);
+    const float* right = this->outputBuffer.getReadPointer(1);
+    for (int i = 0; i < kChunk; i++) {
+      frames[i] = { left[i], right[i] };
+    }
+    this->ring.push(frames, kChunk);
+  }
+
+  void run() override {
+    this->outputBuffer.setSize(2, kChunk);
+    while (!this->threadShouldExit()) {
+      const double rate = this->hostRate.load();
+      if (rate <= 0.0 || this->flushPending.load() || this->ring.getFreeSpace() < kChunk) {
+        this->wait(5);
+        continue;
+      }
+
+      const double newRatio = this->reader->sampleRate / rate;
+      if (newRatio != this->ratio) {
+        this->ratio = newRatio;
+        for (auto& interpolator : this->interpolators) { interpolator.reset(); }
+      }
+      this->renderChunk();
+    }
+  }
+
+public:
+  FilePlayer() : juce::Thread("File player") { this->ring.prepare(kCapacity); }
+  ~FilePlayer() { this->stopThread(1000); }
+
+  //==============================================================================
+  // message thread
+
+  // Replaces the playing file. Returns false if it can't be read, the old file keeps playing
+  bool load(const juce::File& file) {
+    std::unique_ptr<juce::AudioFormatReader> newReader;
+    juce::WavAudioFormat wav;
+    if (auto* mapped = wav.createMemoryMappedReader(file)) {
+      newReader.reset(mapped);
+      if (!mapped->mapEntireFile()) { newReader.reset(); }
+    }
+    if (newReader == nullptr) {
+      juce::AudioFormatManager formats;
+      formats.registerBasicFormats();
+      newReader.reset(formats.createReaderFor(file));
+    }
+    if (newReader == nullptr || newReader->lengthInSamples <= 0) { return false; }
+
+    this->stopThread(1000);
+    this->reader = std::move(newReader);
+    this->fileName = file.getFileName();
+    this->readPosition = 0;
+    this->ratio = 0.0;
+    this->flushPending.store(true); // the audio thread drops the old file's frames
+    this->startThread();
+    return true;
+  }
+
+  bool isLoaded() const { return this->reader != nullptr; }
+  juce::String getFileName() const { return this->fileName; }
+
+  // any thread; the read-ahead thread picks up the new rate on its next pass
+  void prepare(double sampleRate) { this->hostRate.store(sampleRate); }
+
+  //==============================================================================
+  // audio thread
+
+  // Overwrites the first numChannels channels with the file (mono files on every channel).
+  // Plays silence until the read-ahead thread has caught up, e.g. right after a load
+  void read(float* const* channels, int numChannels, int numSamples) {
+    if (this->flushPending.load()) {
+      this->ring.discard();
+      this->flushPending.store(false);
+    }
+
+    Frame frames[256];
+    int done = 0;
+    while (done < numSamples) {
+      int got = this->ring.pop(frames, std::min(256, numSamples - done));
+      if (got == 0) { break; }
+      for (int i = 0; i < got; i++) {
+        channels[0][done + i] = frames[i].left;
+        if (numChannels > 1) { channels[1][done + i] = frames[i].right; }
+      }
+      done += got;
+    }
+    for (int ch = 0; ch < numChannels; ch++) {
+      std::fill(channels[ch] + done, channels[ch] + numSamples, 0.f);
+    }
+  }
+};
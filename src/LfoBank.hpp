@@ -0,0 +1,171 @@
+//====================================================================================================
+/* LfoBank.hpp
+
+Low-frequency oscillators for the modulation stages, owned by the processor. Once per block the
+bank renders every active LFO into its own buffer, and each stage reads its modulation from
+there instead of evaluating an oscillator per sample. Sine is FastMath's polynomial (to the
+build's GIMMEL_FAST_MATH tier) and triangle is piecewise linear; both are branch-free, so every
+LFO's loop vectorizes. LFOs run free in Hz or lock to a division of the host tempo.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "FastMath.hpp"
+
+class LfoBank {
+public:
+  enum class Shape { Sine, Triangle };
+  static constexpr int kMaxLfos = 8;
+
+  // host transport at the start of a block
+  struct Transport {
+    double bpm = 120.0;
+    double ppq = 0.0;   // quarter notes since the start of the timeline
+    bool playing = false;
+    bool valid = false; // false without a playhead or tempo, synced LFOs then run free
+
+    // the transport `numSamples` further into the block
+    Transport advancedBy(int numSamples, double sampleRate) const {
+      Transport t = *this;
+      if (this->playing && sampleRate > 0.0) { t.ppq += numSamples / sampleRate * this->bpm / 60.0; }
+      return t;
+    }
+  };
+
+  // audio thread; getPosition() is the one playhead call hosts allow there
+  static Transport getTransport(juce::AudioPlayHead* playHead) {
+    Transport t;
+    if (playHead == nullptr) { return t; }
+    if (auto position = playHead->getPosition()) {
+      if (auto bpm = position->getBpm()) {
+        t.bpm = *bpm;
+        t.valid = t.bpm > 0.0;
+      }
+      t.ppq = position->getPpqPosition().orFallback(0.0);
+      t.playing = position->getIsPlaying();
+    }
+    return t;
+  }
+
+  // rate choices for synced parameters: "Free", then note values
+  static juce::StringArray getSyncChoices() {
+    return { "Free", "1/1", "1/2", "1/4", "1/8", "1/16", "1/2T", "1/4T", "1/8T", "1/2.", "1/4.", "1/8." };
+  }
+
+  // quarter notes per cycle for a getSyncChoices() index, 0 for "Free"
+  static double getSyncBeats(int choice) {
+    static constexpr double beats[] = { 0.0, 4.0, 2.0, 1.0, 0.5, 0.25, 4.0 / 3.0, 2.0 / 3.0, 1.0 / 3.0, 3.0, 1.5, 0.75 };
+    return beats[juce::jlimit(0, static_cast<int>(std::size(beats)) - 1, choice)];
+  }
+
+private:
+  struct Lfo {
+    Shape shape = Shape::Sine;
+    double phase = 0.0;     // cycles, 0..1
+    double increment = 0.0; // cycles per sample
+    bool active = false;
+    std::vector<float> buffer;
+  };
+
+  Lfo lfos[kMaxLfos];
+  int numLfos = 0;
+  int maxBlockSize = 0;
+  double sampleRate = 0.0;
+  uint32_t blockCount = 0;
+
+  // sin(2 pi t), t in cycles
+  static void renderSine(float* dest, float phase, float increment, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      dest[i] = FastMath::sinCycles(phase + increment * static_cast<float>(i));
+    }
+  }
+
+  // starts at 0 rising, in phase with the sine
+  static void renderTriangle(float* dest, float phase, float increment, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      float u = phase + 0.25f + increment * static_cast<float>(i);
+      u -= static_cast<float>(static_cast<int>(u));
+      dest[i] = 1.f - 4.f * std::abs(u - 0.5f);
+    }
+  }
+
+public:
+  LfoBank() {}
+  ~LfoBank() {}
+
+  // Message thread, before prepare. Returns the LFO's index
+  int add(Shape shape) {
+    jassert(this->numLfos < kMaxLfos);
+    if (this->numLfos >= kMaxLfos) { return kMaxLfos - 1; }
+    this->lfos[this->numLfos].shape = shape;
+    return this->numLfos++;
+  }
+
+  // sizes every LFO's buffer for blocks of up to maxBlockSize and restarts the phases
+  void prepare(double sr, int blockSize) {
+    this->sampleRate = sr;
+    this->maxBlockSize = std::max(blockSize, 1);
+    for (int n = 0; n < this->numLfos; n++) {
+      this->lfos[n].buffer.assign(static_cast<size_t>(this->maxBlockSize), 0.f);
+      this->lfos[n].phase = 0.0;
+    }
+  }
+
+  int getMaxBlockSize() const { return this->maxBlockSize; }
+
+  //==============================================================================
+  // audio thread
+
+  // inactive LFOs are skipped by process() and hold their phase
+  void setActive(int lfo, bool active) { this->lfos[lfo].active = active; }
+
+  void setFrequency(int lfo, double hz) {
+    this->lfos[lfo].increment = this->sampleRate > 0.0 ? hz / this->sampleRate : 0.0;
+  }
+
+  // one cycle every `beatsPerCycle` quarter notes; while the transport plays the phase
+  // follows the song position, so the LFO lines up with the bar after a locate
+  void syncToTransport(int lfo, const Transport& transport, double beatsPerCycle) {
+    if (!transport.valid || beatsPerCycle <= 0.0) { return; }
+    this->setFrequency(lfo, transport.bpm / 60.0 / beatsPerCycle);
+    if (transport.playing) {
+      const double cycles = transport.ppq / beatsPerCycle;
+      this->lfos[lfo].phase = cycles - std::floor(cycles);
+    }
+  }
+
+  // renders the next numSamples (at most getMaxBlockSize()) of every active LFO
+  void process(int numSamples) {
+    jassert(numSamples <= this->maxBlockSize);
+    numSamples = std::min(numSamples, this->maxBlockSize);
+    for (int n = 0; n < this->numLfos; n++) {
+      Lfo& lfo = this->lfos[n];
+      if (!lfo.active || lfo.buffer.empty()) { continue; }
+
+      const float phase = static_cast<float>(lfo.phase);
+      const float increment = static_cast<float>(lfo.increment);
+      if (lfo.shape == Shape::Sine) {
+        renderSine(lfo.buffer.data(), phase, increment, numSamples);
+      } else {
+        renderTriangle(lfo.buffer.data(), phase, increment, numSamples);
+      }
+      const double next = lfo.phase + lfo.increment * numSamples;
+      lfo.phase = next - std::floor(next);
+    }
+    this->blockCount++;
+  }
+
+  // the LFO's values for the block process() last rendered, -1..1
+  const float* getBuffer(int lfo) const { return this->lfos[lfo].buffer.data(); }
+
+  // changes on every process(), so readers know when a new block starts
+  uint32_t getBlockCount() const { return this->blockCount; }
+};
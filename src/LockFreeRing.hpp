@@ -0,0 +1,74 @@
+//====================================================================================================
+/* LockFreeRing.hpp
+
+Single-producer, single-consumer ring of trivially copyable items for handing data from the
+audio thread to the GUI or a worker thread. Built on juce::AbstractFifo: neither side waits,
+and a full ring drops the newest items instead of blocking the writer.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include <juce_core/juce_core.h>
+
+template <typename T>
+class LockFreeRing {
+  static_assert(std::is_trivially_copyable<T>::value, "LockFreeRing copies items with memcpy");
+
+private:
+  juce::AbstractFifo fifo { 2 };
+  std::vector<T> storage;
+
+public:
+  LockFreeRing() { this->prepare(1); }
+  ~LockFreeRing() {}
+
+  // not thread safe, call before either side starts (e.g. in prepareToPlay)
+  void prepare(int capacity) {
+    capacity = std::max(capacity, 1);
+    this->storage.assign(static_cast<size_t>(capacity) + 1, T{}); // AbstractFifo keeps one slot free
+    this->fifo.setTotalSize(capacity + 1);
+    this->fifo.reset();
+  }
+
+  int getCapacity() const { return this->fifo.getTotalSize() - 1; }
+
+  //==============================================================================
+  // producer side
+
+  // copies up to `count` items in at most two memcpys. Returns the number written
+  int push(const T* items, int count) {
+    int start1, size1, start2, size2;
+    this->fifo.prepareToWrite(count, start1, size1, start2, size2);
+    if (size1 > 0) { std::copy(items, items + size1, this->storage.data() + start1); }
+    if (size2 > 0) { std::copy(items + size1, items + size1 + size2, this->storage.data() + start2); }
+    this->fifo.finishedWrite(size1 + size2);
+    return size1 + size2;
+  }
+
+  bool push(const T& item) { return this->push(&item, 1) == 1; }
+
+  int getFreeSpace() const { return this->fifo.getFreeSpace(); }
+
+  //==============================================================================
+  // consumer side
+
+  // copies up to `count` items out. Returns the number read
+  int pop(T* dest, int count) {
+    int start1, size1, start2, size2;
+    this->fifo.prepareToRead(count, start1, size1, start2, size2);
+    if (size1 > 0) { std::copy(this->storage.data() + start1, this->storage.data() + start1 + size1, dest); }
+    if (size2 > 0) { std::copy(this->storage.data() + start2, this->storage.data() + start2 + size2, dest + size1); }
+    this->fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+  }
+
+  int getNumReady() const { return this->fifo.getNumReady(); }
+
+  // drops everything waiting, e.g. when a reader comes back after a pause
+  void discard() { this->fifo.finishedRead(this->fifo.getNumReady()); }
+};
@@ -0,0 +1,94 @@
+//====================================================================================================
+/* Oversampling.hpp
+
+Opt-in oversampling for individual stages of the chain. An OversampledSlot runs its giml
+effect at 2x, 4x or 8x the host rate between polyphase half-band IIR up/down filters
+(juce::dsp::Oversampling), so only the nonlinear and modulated-delay effects that alias pay for
+it. Each slot reports the latency its filters add; the chain sums it for the host.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <memory>
+#include <juce_dsp/juce_dsp.h>
+#include "EffectsChain.hpp"
+
+template <class Fx>
+class OversampledSlot : public EffectSlot<Fx> {
+public:
+  static constexpr int kMaxOrder = 3; // 8x
+
+private:
+  std::unique_ptr<juce::dsp::Oversampling<float>> oversampler;
+  int order = 0; // factor is 1 << order
+  int latency = 0;
+  int preparedBlockSize = 0;
+
+public:
+  OversampledSlot() {}
+  ~OversampledSlot() {}
+
+  // `factorOrder` 0 runs at the host rate; 1, 2 and 3 run the effect at 2x, 4x and 8x.
+  // Not real-time safe: the instances are rebuilt at the oversampled rate, the filters only
+  // when the factor, block size or layout changes and otherwise cleared
+  void prepare(int sampleRate, int numChannels, int maxBlockSize, int factorOrder) {
+    factorOrder = juce::jlimit(0, kMaxOrder, factorOrder);
+    const bool sameFilters = factorOrder == this->order && maxBlockSize == this->preparedBlockSize
+                          && std::min(std::max(numChannels, 1), kMaxChannels) == this->getNumLanes();
+    this->order = factorOrder;
+    this->preparedBlockSize = maxBlockSize;
+    EffectSlot<Fx>::prepare(sampleRate << this->order, numChannels);
+
+    if (this->order == 0) {
+      this->oversampler.reset();
+      this->latency = 0;
+      return;
+    }
+    if (sameFilters && this->oversampler != nullptr) {
+      this->oversampler->reset();
+      return;
+    }
+
+    this->oversampler = std::make_unique<juce::dsp::Oversampling<float>>(
+        static_cast<size_t>(this->getNumLanes()), static_cast<size_t>(this->order),
+        juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, true); // integer latency
+    this->oversampler->initProcessing(static_cast<size_t>(std::max(maxBlockSize, 1)));
+    this->latency = juce::roundToInt(this->oversampler->getLatencyInSamples());
+  }
+
+  void release() {
+    EffectSlot<Fx>::release();
+    this->oversampler.reset();
+    this->latency = 0;
+    this->preparedBlockSize = 0;
+  }
+
+  int getFactor() const { return 1 << this->order; }
+  int getLatencySamples() const override { return this->latency; }
+
+  void processBlock(const float* const* in, float* const* out, int numChannels, int numSamples) override {
+    if (this->oversampler == nullptr) {
+      EffectSlot<Fx>::processBlock(in, out, numChannels, numSamples);
+      return;
+    }
+
+    for (int ch = 0; ch < numChannels; ch++) {
+      if (in[ch] != out[ch]) { std::copy(in[ch], in[ch] + numSamples, out[ch]); }
+    }
+
+    // channels without a lane (there are none for mono/stereo layouts) pass through as copied
+    const int numLanes = std::min(numChannels, this->getNumLanes());
+    juce::dsp::AudioBlock<float> block(out, static_cast<size_t>(numLanes), static_cast<size_t>(numSamples));
+    auto up = this->oversampler->processSamplesUp(block);
+
+    float* upChannels[kMaxChannels];
+    for (int ch = 0; ch < numLanes; ch++) {
+      upChannels[ch] = up.getChannelPointer(static_cast<size_t>(ch));
+    }
+    EffectSlot<Fx>::processBlock(upChannels, upChannels, numLanes, static_cast<int>(up.getNumSamples()));
+
+    this->oversampler->processSamplesDown(block);
+  }
+};
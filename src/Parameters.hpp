@@ -29,6 +29,81 @@ class ParameterBundle;
 class ParameterStack;
 class EffectGui;
 
+// Ramps a value toward its target over a fixed time, either linearly or exponentially.
+// Rendering a settled ramp is a single vectorized fill.
+class Smoother {
+public:
+  enum class Type { Linear, Exponential };
+
+private:
+  Type type = Type::Linear;
+  float rampMs = 0.f;
+  double sampleRate = 0.0; // no ramps until prepared
+  float current = 0.f;
+  float target = 0.f;
+  float step = 0.f;        // linear: increment per sample
+  float coeff = 0.f;       // exponential: remaining distance kept per sample
+  int remaining = 0;       // samples left in the current ramp
+
+public:
+  Smoother() {}
+  ~Smoother() {}
+
+  void setType(Type t) { this->type = t; }
+  void setRampTime(float ms) { this->rampMs = std::max(0.f, ms); }
+  void prepare(double sr) { this->sampleRate = sr; }
+
+  void reset(float value) {
+    this->current = this->target = value;
+    this->remaining = 0;
+  }
+
+  void setTarget(float newTarget) {
+    this->target = newTarget;
+    int rampSamples = static_cast<int>(this->rampMs * 0.001 * this->sampleRate);
+    if (rampSamples <= 0 || newTarget == this->current) {
+      this->reset(newTarget);
+      return;
+    }
+
+    this->remaining = rampSamples;
+    if (this->type == Type::Linear) {
+      this->step = (this->target - this->current) / static_cast<float>(rampSamples);
+    } else {
+      // close 60 dB of the distance over the ramp, then snap to the target
+      this->coeff = static_cast<float>(std::exp(std::log(0.001) / rampSamples));
+    }
+  }
+
+  bool isRamping() const { return this->remaining > 0; }
+  float getCurrent() const { return this->current; }
+
+  // writes the next numSamples values of the ramp into dest and advances it
+  void fill(float* dest, int numSamples) {
+    int n = std::min(numSamples, this->remaining);
+    if (this->type == Type::Linear) {
+      // closed form, no loop-carried dependency, so the compiler vectorizes it
+      const float start = this->current;
+      const float inc = this->step;
+      for (int i = 0; i < n; i++) {
+        dest[i] = start + inc * static_cast<float>(i + 1);
+      }
+      this->current = start + inc * static_cast<float>(n);
+    } else {
+      for (int i = 0; i < n; i++) {
+        this->current = this->target + (this->current - this->target) * this->coeff;
+        dest[i] = this->current;
+      }
+    }
+
+    this->remaining -= n;
+    if (this->remaining == 0) { this->current = this->target; }
+    if (n < numSamples) {
+      juce::FloatVectorOperations::fill(dest + n, this->target, numSamples - n);
+    }
+  }
+};
+
 // Interface class
 class Parameter {
 protected: 
@@ -36,6 +111,15 @@ protected:
   bool amToggle = false;
   bool amChoice = false;
 
+  // binding to the treeState, resolved once by bind() so the audio thread never looks up by name
+  std::atomic<float>* rawValue = nullptr;
+  float lastRaw = 0.f;
+  float value = 0.f;
+  bool dirty = true;
+
+  // hook for subclasses that track the value (e.g. smoothing)
+  virtual void valueChanged() {}
+
 public:
   Parameter() {}
   virtual ~Parameter() {}
@@ -45,6 +129,60 @@ public:
   bool isChoice() { return this->amChoice; }
   virtual void addToTree(PARAM_LIST& pList) = 0;
   virtual void addToGui(EffectGui& gui, APVTS& treeState) = 0;
+
+  void bind(APVTS& treeState) {
+    this->rawValue = treeState.getRawParameterValue(this->name);
+    jassert(this->rawValue != nullptr); // must be called after the treeState is built
+    this->lastRaw = this->value = this->rawValue->load();
+    this->dirty = true;
+    this->prepare(0.0, 0);
+  }
+
+  virtual void prepare(double sampleRate, int maxBlockSize) { juce::ignoreUnused(sampleRate, maxBlockSize); }
+
+  // Called once per block on the audio thread. Returns true if the parameter moved
+  // since the last poll (or was marked dirty), false in the common no-automation case
+  bool poll() {
+    float raw = this->rawValue->load(std::memory_order_relaxed);
+    if (raw != this->lastRaw) {
+      this->lastRaw = raw;
+      this->value = raw;
+      this->dirty = true;
+      this->valueChanged();
+    }
+    bool changed = this->dirty;
+    this->dirty = false;
+    return changed;
+  }
+
+  void markDirty() { this->dirty = true; }
+
+  // Audio thread: takes `v` ahead of the treeState, e.g. from a program snapshot. The
+  // treeState catching up to the same value later reads as no change
+  void assign(float v) {
+    this->value = v;
+    this->dirty = true;
+    this->valueChanged();
+  }
+
+  // Message thread: drops anything assigned ahead of the treeState and starts over from it
+  void reload() {
+    this->lastRaw = this->value = this->rawValue->load();
+    this->dirty = true;
+    this->valueChanged();
+  }
+
+  float get() const { return this->value; }
+  // reads the treeState directly, for the message thread (the audio thread polls)
+  float load() const { return this->rawValue->load(); }
+  bool isOn() const { return this->value >= 0.5f; }
+  int getIndex() const { return static_cast<int>(this->value); }
+
+  // Renders this block's smoothing ramp, returns true if the parameter is ramping
+  virtual bool renderRamp(int numSamples) { juce::ignoreUnused(numSamples); return false; }
+
+  // value `offset` samples into the current block
+  virtual float at(int offset) const { juce::ignoreUnused(offset); return this->value; }
 };
 
 class ParameterBundle : public std::vector<Parameter*> {
@@ -86,6 +224,42 @@ public:
     }
   }
 
+  void bind(APVTS& treeState) {
+    for (auto& param : *this) {
+      param->bind(treeState);
+    }
+  }
+
+  // polls every parameter (no short circuit) and reports whether any of them moved
+  bool poll() {
+    bool changed = false;
+    for (auto& param : *this) {
+      changed |= param->poll();
+    }
+    return changed;
+  }
+
+  void markDirty() {
+    for (auto& param : *this) {
+      param->markDirty();
+    }
+  }
+
+  void prepare(double sampleRate, int maxBlockSize) {
+    for (auto& param : *this) {
+      param->prepare(sampleRate, maxBlockSize);
+    }
+  }
+
+  // renders every parameter's ramp for this block, true if any of them is ramping
+  bool renderRamps(int numSamples) {
+    bool ramping = false;
+    for (auto& param : *this) {
+      ramping |= param->renderRamp(numSamples);
+    }
+    return ramping;
+  }
+
 };
 
 class ParameterStack : public std::vector<ParameterBundle*> {
@@ -126,11 +300,63 @@ class ParameterStack : public std::vector<ParameterBundle*> {
         bundle->addToGui(gui, treeState);
       }
     }
+
+    void bind(APVTS& treeState) {
+      for (auto& bundle : *this) {
+        bundle->bind(treeState);
+      }
+    }
+
+    void markDirty() {
+      for (auto& bundle : *this) {
+        bundle->markDirty();
+      }
+    }
+
+    void prepare(double sampleRate, int maxBlockSize) {
+      for (auto& bundle : *this) {
+        bundle->prepare(sampleRate, maxBlockSize);
+      }
+    }
+
+    // calls `fn(param, index)` for every parameter, indexed in stack order
+    template <typename Fn>
+    void forEachParameter(Fn&& fn) {
+      int index = 0;
+      for (auto& bundle : *this) {
+        for (auto& param : *bundle) {
+          fn(*param, index++);
+        }
+      }
+    }
+
+    int getNumParameters() {
+      int n = 0;
+      for (auto& bundle : *this) { n += static_cast<int>(bundle->size()); }
+      return n;
+    }
+
+    // audio thread: assigns one value per parameter, in forEachParameter order. NaN leaves
+    // that parameter as it is
+    void assign(const std::vector<float>& values) {
+      this->forEachParameter([&values](Parameter& param, int index) {
+        if (index >= static_cast<int>(values.size())) { return; }
+        const float v = values[static_cast<size_t>(index)];
+        if (!std::isnan(v)) { param.assign(v); }
+      });
+    }
   
   };
 
+// One effect's tab. The sliders, boxes and their attachments exist only while the tab is on
+// show: build() makes them from the bundle, release() tears them down again so a hidden tab
+// costs nothing on open and doesn't listen to its parameters
 class EffectGui : public juce::Component {
 private:
+  ParameterBundle* bundle = nullptr;
+  APVTS* treeState = nullptr;
+  bool built = false;
+
   std::unique_ptr<juce::ToggleButton> toggle;
   std::unique_ptr<BUTTON_ATTACHMENT> bAttachment;
   std::vector<std::unique_ptr<juce::Slider>> params;
@@ -147,6 +373,34 @@ public:
     this->toggle->setButtonText("Toggle");
   }
 
+  // what build() attaches to
+  void setParams(ParameterBundle& params, APVTS& state) {
+    this->bundle = &params;
+    this->treeState = &state;
+  }
+
+  bool isBuilt() const { return this->built; }
+
+  void build() {
+    if (this->built || this->bundle == nullptr) { return; }
+    this->attachParams(*this->bundle, *this->treeState);
+    this->makeVisible();
+    this->resized();
+    this->built = true;
+  }
+
+  // attachments go first: they listen to the components as well as the parameters
+  void release() {
+    if (!this->built) { return; }
+    cAttachments.clear();
+    sAttachments.clear();
+    bAttachment.reset();
+    labels.clear();
+    params.clear();
+    choices.clear();
+    this->built = false;
+  }
+
   void makeVisible() {
     addAndMakeVisible(toggle.get());
 
@@ -245,30 +499,41 @@ class FxMenu : public juce::TabbedComponent {
       }
     }
 
+    // the tab's components are built the first time it's shown
     void addEffect(std::string name, ParameterBundle& params, APVTS& treeState) {
       auto eg = std::make_unique<EffectGui>(name);
-      eg->attachParams(params, treeState);
-      eg->makeVisible();
-      eg->resized();
+      eg->setParams(params, treeState);
+      EffectGui* gui = eg.get();
       addTab(name, juce::Colours::darkolivegreen, eg.release(), true);
+      if (getCurrentTabIndex() == getNumTabs() - 1) { gui->build(); }
+    }
+
+    // only the tab on show keeps its components and attachments
+    void currentTabChanged(int newCurrentTabIndex, const juce::String& newCurrentTabName) override {
+      juce::ignoreUnused(newCurrentTabName);
+      for (int i = 0; i < getNumTabs(); i++) {
+        if (auto* gui = dynamic_cast<EffectGui*>(getTabContentComponent(i))) {
+          if (i == newCurrentTabIndex) { gui->build(); } else { gui->release(); }
+        }
+      }
     }
   
   };
 
   class ParameterBool : public Parameter {
     private:
-      bool value = false;
+      bool def = false; // the treeState's default; the live value is Parameter::value
     
     public:
     
       ParameterBool(std::string name, bool def = false) {
         this->amToggle = true;
         this->name = name;
-        this->value = def;
+        this->def = def;
       }
     
       void addToTree(PARAM_LIST& pList) override {
-        pList.push_back(MAKE_PARAMB(this->name, this->name, value));
+        pList.push_back(MAKE_PARAMB(this->name, this->name, def));
       }
     
       void addToGui(EffectGui& gui, APVTS& treeState) override {
@@ -280,6 +545,14 @@ class FxMenu : public juce::TabbedComponent {
     class ParameterFloat : public Parameter {
     private:
       float min = 0.f, max = 1.f, def = 0.f;
+      Smoother smoother;
+      std::vector<float> ramp; // this block's per-sample values while ramping
+      bool rampActive = false;
+
+    protected:
+      void valueChanged() override {
+        smoother.setTarget(this->value);
+      }
     
     public:
     
@@ -289,6 +562,35 @@ class FxMenu : public juce::TabbedComponent {
         this->max = maxVal;
         this->def = def;
       }
+
+      // Opt-in per-sample smoothing. With rampMs = 0 (the default) changes apply at block rate
+      void setSmoothing(Smoother::Type type, float rampMs) {
+        smoother.setType(type);
+        smoother.setRampTime(rampMs);
+      }
+
+      void prepare(double sampleRate, int maxBlockSize) override {
+        smoother.prepare(sampleRate);
+        smoother.reset(this->value);
+        ramp.assign(static_cast<size_t>(std::max(maxBlockSize, 1)), this->value);
+        rampActive = false;
+      }
+
+      // Reports the block after a ramp ends as ramping too: the last sub-block update read the
+      // ramp short of its end, and that block's first update (at() gives the target) catches up
+      bool renderRamp(int numSamples) override {
+        const bool wasActive = rampActive;
+        rampActive = smoother.isRamping();
+        if (rampActive) {
+          smoother.fill(ramp.data(), std::min(numSamples, static_cast<int>(ramp.size())));
+        }
+        return rampActive || wasActive;
+      }
+
+      float at(int offset) const override {
+        if (!rampActive) { return this->value; }
+        return ramp[static_cast<size_t>(std::min(offset, static_cast<int>(ramp.size()) - 1))];
+      }
     
       void addToTree(PARAM_LIST& pList) override {
         pList.push_back(MAKE_PARAMF(this->name, this->name, min, max, def));
@@ -3,7 +3,10 @@
 
 //==============================================================================
 AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAudioProcessor& p)
-    : AudioProcessorEditor (&p), processorRef (p)
+    : AudioProcessorEditor (&p), processorRef (p),
+      mOrderView (p.getEffectNames(), [&p] { return p.getEffectOrder(); },
+                  [&p] (const std::vector<int>& order) { p.setEffectOrder (order); }),
+      mSpectrum (p.analyzer, [&p] { return p.getSampleRate(); })
 {
     juce::ignoreUnused (processorRef);
     // Make sure that before the constructor has finished, you've set the
@@ -20,15 +23,51 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     mFxMenu.addEffect("Tremolo", p.tremoloParams, p.treeState);
     mFxMenu.addEffect("Envelope", p.envelopeParams, p.treeState);
     addAndMakeVisible(&mFxMenu);
+    addAndMakeVisible(&mOrderView); // the chain's order, edited while audio runs
 
-    for (auto& scope : processorRef.scopes) 
+    mInputBox.addItemList(juce::StringArray{"Live", "File"}, 1);
+    mInputAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(p.treeState, p.inputSource.getName(), mInputBox);
+    mLoadButton.onClick = [this] {
+        chooseFile("Test signal", [this](const juce::File& f) { return processorRef.filePlayer.load(f); }, mFileLabel);
+    };
+    mFileLabel.setText(p.filePlayer.isLoaded() ? p.filePlayer.getFileName() : "No file", juce::dontSendNotification);
+    addAndMakeVisible(&mInputBox);
+    addAndMakeVisible(&mLoadButton);
+    addAndMakeVisible(&mFileLabel);
+
+    mIrButton.onClick = [this] {
+        chooseFile("Impulse response", [this](const juce::File& f) { return processorRef.loadImpulseResponse(f); }, mIrLabel);
+    };
+    mIrLabel.setText(p.getImpulseResponseName().isEmpty() ? "No IR" : p.getImpulseResponseName(), juce::dontSendNotification);
+    addAndMakeVisible(&mIrButton);
+    addAndMakeVisible(&mIrLabel);
+
+    for (auto& scope : scopes) 
     {
         addAndMakeVisible(&scope);
     }
+    scopes[ScopeFeed::Output].setColours(juce::Colours::black, juce::Colours::blue);
+    configureScopes(processorRef.getSampleRate());
+
+    // the audio thread only writes scope data while we're attached
+    processorRef.scopeFeed.attach();
+    startTimerHz(30);
+
+    // the analyzer thread runs only while the editor is open
+    addAndMakeVisible(&mSpectrum);
+    processorRef.analyzer.start();
+
+   #if GIMMEL_PROFILE
+    mProfilerView = std::make_unique<ProfilerView>(processorRef.profiler, processorRef.getEffectNames());
+    addAndMakeVisible(mProfilerView.get());
+   #endif
 }
 
 AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor()
 {
+    stopTimer();
+    processorRef.scopeFeed.detach();
+    processorRef.analyzer.stop();
 }
 
 //==============================================================================
@@ -43,10 +82,73 @@ void AudioPluginAudioProcessorEditor::resized()
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
     auto bounds = getLocalBounds();
-    mFxMenu.setBounds(0, 0, bounds.getWidth() / 2, bounds.getHeight());
-    int scopeHeight = bounds.getHeight() / processorRef.numScopes;
-    for (size_t i = 0; i < processorRef.numScopes; ++i) 
+    auto left = bounds.withWidth(bounds.getWidth() / 2);
+    auto inputBar = left.removeFromTop(28).reduced(2);
+    mInputBox.setBounds(inputBar.removeFromLeft(80));
+    mLoadButton.setBounds(inputBar.removeFromLeft(100));
+    mFileLabel.setBounds(inputBar.removeFromLeft(inputBar.getWidth() / 2));
+    mIrButton.setBounds(inputBar.removeFromLeft(90));
+    mIrLabel.setBounds(inputBar);
+    mOrderView.setBounds(left.removeFromTop(28).reduced(2));
+    mFxMenu.setBounds(left);
+    auto right = bounds.withTrimmedLeft(bounds.getWidth() / 2);
+   #if GIMMEL_PROFILE
+    mProfilerView->setBounds(right.removeFromBottom(bounds.getHeight() / 3));
+   #endif
+    // input, output, and spectral scopes
+    int scopeHeight = right.getHeight() / (ScopeFeed::NumScopes + 1);
+    for (int i = 0; i < ScopeFeed::NumScopes; ++i) 
+    {
+        scopes[i].setBounds(right.getX(), right.getY() + i * scopeHeight, right.getWidth(), scopeHeight);
+    }
+    mSpectrum.setBounds(right.withTrimmedTop(ScopeFeed::NumScopes * scopeHeight));
+}
+
+//==============================================================================
+void AudioPluginAudioProcessorEditor::chooseFile (const juce::String& title, std::function<bool (const juce::File&)> load, juce::Label& label)
+{
+    mChooser = std::make_unique<juce::FileChooser>(title, juce::File(), "*.wav;*.aif;*.aiff;*.flac");
+    mChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                          [load, &label](const juce::FileChooser& chooser)
+                          {
+                              auto file = chooser.getResult();
+                              if (file == juce::File())
+                                  return;
+
+                              if (load(file))
+                                  label.setText(file.getFileName(), juce::dontSendNotification);
+                              else
+                                  label.setText("Can't read " + file.getFileName(), juce::dontSendNotification);
+                          });
+}
+
+void AudioPluginAudioProcessorEditor::configureScopes (double sampleRate)
+{
+    // One second of history, decimated to kColumnsPerSecond min/max pairs: the reduction runs
+    // here in pushBuffer, never on the audio thread
+    constexpr int kColumnsPerSecond = 500;
+    scopeSampleRate = sampleRate;
+    const int samplesPerColumn = juce::jmax(1, juce::roundToInt(sampleRate / kColumnsPerSecond));
+    for (auto& scope : scopes) 
+    {
+        scope.setNumChannels(1);
+        scope.setSamplesPerBlock(samplesPerColumn);
+        scope.setBufferSize(kColumnsPerSecond);
+    }
+}
+
+void AudioPluginAudioProcessorEditor::timerCallback()
+{
+    const double sampleRate = processorRef.getSampleRate();
+    if (sampleRate > 0.0 && sampleRate != scopeSampleRate)
+        configureScopes(sampleRate);
+
+    for (int i = 0; i < ScopeFeed::NumScopes; ++i) 
     {
-        processorRef.scopes[i].setBounds(bounds.getWidth() / 2, i * scopeHeight, bounds.getWidth() / 2, scopeHeight);
+        const auto scope = static_cast<ScopeFeed::Scope>(i);
+        const float* data = scopeScratch.data();
+        int numSamples;
+        while ((numSamples = processorRef.scopeFeed.pop(scope, scopeScratch.data(), static_cast<int>(scopeScratch.size()))) > 0)
+            scopes[i].pushBuffer(&data, 1, numSamples);
     }
 }
\ No newline at end of file
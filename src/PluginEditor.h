@@ -3,9 +3,11 @@
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "PluginProcessor.h"
 #include "Parameters.hpp"
+#include "ChainOrderView.hpp"
 
 //==============================================================================
-class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor
+class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor,
+                                              private juce::Timer
 {
 public:
     explicit AudioPluginAudioProcessorEditor (AudioPluginAudioProcessor&);
@@ -16,10 +18,38 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+    void configureScopes (double sampleRate);
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     AudioPluginAudioProcessor& processorRef;
     FxMenu mFxMenu;
+    ChainOrderView mOrderView;
+
+    // input source and test file
+    juce::ComboBox mInputBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> mInputAttachment;
+    juce::TextButton mLoadButton { "Load file..." };
+    juce::Label mFileLabel;
+    std::unique_ptr<juce::FileChooser> mChooser;
+
+    // impulse response for the reverb's convolution mode
+    juce::TextButton mIrButton { "Load IR..." };
+    juce::Label mIrLabel;
+
+    // `load` returns false if the file can't be read; `label` shows the outcome
+    void chooseFile (const juce::String& title, std::function<bool (const juce::File&)> load, juce::Label& label);
+
+    // input and output scopes, fed from the processor's ScopeFeed on the message thread
+    juce::AudioVisualiserComponent scopes[ScopeFeed::NumScopes] { { 1 }, { 1 } };
+    std::vector<float> scopeScratch = std::vector<float> (4096);
+    double scopeSampleRate = 0.0;
+
+    SpectrumView mSpectrum;
+   #if GIMMEL_PROFILE
+    std::unique_ptr<ProfilerView> mProfilerView;
+   #endif
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessorEditor)
 };
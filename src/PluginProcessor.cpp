@@ -12,6 +12,10 @@ parameters(ParameterStack& params) {
     
     return { parameter_list.begin(), parameter_list.end() };
 }
+
+static bool containsParameter(const std::vector<Parameter*>& params, const juce::String& parameterID) {
+    return std::any_of(params.begin(), params.end(), [&parameterID](Parameter* p) { return parameterID == juce::String(p->getName()); });
+}
 //==============================================================================
 AudioPluginAudioProcessor::AudioPluginAudioProcessor()
      : AudioProcessor (BusesProperties()
@@ -23,10 +27,116 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
                      #endif
                        ), treeState(*this, nullptr, "Parameters", parameters(fxParams))
 {
+    // resolve every parameter's atomic once, so processBlock never looks them up by name
+    fxParams.bind(treeState);
+    fxParams.forEachParameter([this](Parameter& param, int) { automationTargets.push_back(&param); });
+    buildPrograms();
+
+   #if GIMMEL_PROFILE
+    mEffectsChain.setProfiler(&profiler);
+   #endif
+
+    // every effect parameter can change the chain's tail, some also need a rebuild
+    for (auto* param : automationTargets)
+        treeState.addParameterListener(param->getName(), this);
+    mReverb.setImpulseListener ([this] {
+        tailNeeded.store (true);
+        triggerAsyncUpdate();
+    });
+
+    // per-sample smoothing for params that zipper under automation
+    for (auto* param : { &chorusRate, &chorusDepth, &chorusBlend, &compressorMakeup,
+                         &delayFeedback, &delayBlend, &detuneBlend, &flangerRate, &flangerDepth,
+                         &flangerBlend, &phaserRate, &phaserFeedback, &reverbBlend,
+                         &tremoloRate, &tremoloDepth })
+    {
+        param->setSmoothing(Smoother::Type::Linear, 20.f);
+    }
+    delayTime.setSmoothing(Smoother::Type::Linear, 100.f);
+    compressorThreshold.setSmoothing(Smoother::Type::Exponential, 50.f);
+
+    // The line and the arena are laid out once. prepareToPlay only (re)builds the instances
+    for (auto* slot : std::initializer_list<BlockEffect*>{ &mChorus, &mCompressor, &mDelay, &mDetune, &mFlanger,
+                                                           &mPhaser, &mReverb, &mTremolo, &mEnvelope })
+    {
+        mEffectsChain.pushBack(slot);
+    }
+    mChorus.placeIn(mArena);
+    mCompressor.placeIn(mArena);
+    mDelay.placeIn(mArena);
+    mDetune.placeIn(mArena);
+    mFlanger.placeIn(mArena);
+    mPhaser.placeIn(mArena);
+    mReverb.placeIn(mArena);
+    mEnvelope.placeIn(mArena);
+    mTremolo.attach(lfoBank);
+    mReverb.setModeParam(reverbMode);
+
+    // setters the chain calls when an effect's params move, `offset` samples into the block.
+    // Toggles are read by the chain itself, which drops bypassed effects from the line
+    mChorus.bindParams(chorusParams, [this](auto& fx, int offset) {
+        fx.setParams(chorusRate.at(offset), chorusDepth.at(offset), chorusBlend.at(offset));
+    });
+
+    mCompressor.bindParams(compressorParams, [this](auto& fx, int offset) {
+        fx.setParams(compressorThreshold.at(offset), compressorRatio.at(offset), compressorMakeup.at(offset),
+                     compressorKnee.at(offset), compressorAttack.at(offset), compressorRelease.at(offset));
+    });
+
+    mDelay.bindParams(delayParams, [this](auto& fx, int offset) {
+        fx.setParams(delayTime.at(offset), delayFeedback.at(offset), delayDamping.at(offset), delayBlend.at(offset));
+    });
+
+    mDetune.bindParams(detuneParams, [this](auto& fx, int offset) {
+        fx.setParams(detunePitchRatio.at(offset), detuneWindowSize.at(offset), detuneBlend.at(offset));
+    });
+
+    mFlanger.bindParams(flangerParams, [this](auto& fx, int offset) {
+        fx.setParams(flangerRate.at(offset), flangerDepth.at(offset), flangerBlend.at(offset));
+    });
+
+    mPhaser.bindParams(phaserParams, [this](auto& fx, int offset) {
+        fx.setParams(phaserRate.at(offset), phaserFeedback.at(offset));
+    });
+
+    mReverb.bindParams(reverbParams, [this](auto& fx, int offset) {
+        fx.setParams(reverbTime.at(offset), reverbRegen.at(offset), reverbDamping.at(offset), reverbBlend.at(offset),
+                     reverbRoomLength.at(offset), reverbAbsorptionCoefficient.at(offset),
+                     static_cast<giml::Reverb<float>::RoomType>(reverbRoomType.getIndex()));
+        mReverb.setBlend(reverbBlend.at(offset));
+    });
+
+    mTremolo.bindParams(tremoloParams, [this](auto& fx, int offset) {
+        fx.setParams(tremoloRate.at(offset), tremoloDepth.at(offset), tremoloSync.getIndex());
+    });
+
+    mEnvelope.bindParams(envelopeParams, [this](auto& fx, int offset) {
+        fx.setParams(envelopeQFactor.at(offset), envelopeAttackMs.at(offset), envelopeReleaseMs.at(offset));
+    });
+
+    // How long each effect keeps sounding once its input stops, from its current params. These
+    // add up to the tail the host is told about, and let idle effects skip blocks of silence.
+    // The tremolo is memoryless and keeps the default of no tail
+    mChorus.setTail([this] { return 0.05 + chorusDepth.load() * 0.001; });
+    mCompressor.setTail([this] { return compressorRelease.load() * 0.001 * 7.0; }); // envelope down 60 dB
+    mDelay.setTail([this] { return BlockEffect::ringTime(delayTime.load() * 0.001, delayFeedback.load()); });
+    mDetune.setTail([this] { return detuneWindowSize.load() * 0.001; });
+    mFlanger.setTail([this] { return 0.02 + flangerDepth.load() * 0.001; });
+    mPhaser.setTail([this] { return BlockEffect::ringTime(0.005, phaserFeedback.load()); });
+    mReverb.setTail([this] {
+        if (reverbMode.load() > 0.5f)
+            return mReverb.getImpulseSeconds();
+        return BlockEffect::ringTime(reverbTime.load(), reverbRegen.load());
+    });
+    mEnvelope.setTail([this] { return envelopeReleaseMs.load() * 0.001; });
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor()
 {
+    for (auto* param : automationTargets)
+        treeState.removeParameterListener(param->getName(), this);
+    cancelPendingUpdate();
+    stopTimer();
 }
 
 //==============================================================================
@@ -64,34 +174,87 @@ bool AudioPluginAudioProcessor::isMidiEffect() const
 
 double AudioPluginAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // infinite while a delay or reverb is set to feed back forever
+    return mEffectsChain.getTailSeconds();
 }
 
 int AudioPluginAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return static_cast<int> (programs.size()); // "Init" at least: some hosts don't cope with 0 programs
 }
 
 int AudioPluginAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void AudioPluginAudioProcessor::setCurrentProgram (int index)
 {
-    juce::ignoreUnused (index);
+    if (! juce::isPositiveAndBelow (index, getNumPrograms()))
+        return;
+
+    currentProgram = index;
+    const auto& program = programs[static_cast<size_t> (index)];
+    if (! preparedToPlay)
+    {
+        program.pushToTree (fxParams, treeState); // no audio thread to hand it to
+        return;
+    }
+
+    // the audio thread switches every parameter in one block; the treeState follows once it has
+    adoptedAtPublish = programSwitcher.getAdoptedCount();
+    syncTicks = 0;
+    programSwitcher.publish (program);
+    startTimer (10);
 }
 
 const juce::String AudioPluginAudioProcessor::getProgramName (int index)
 {
-    juce::ignoreUnused (index);
-    return {};
+    if (! juce::isPositiveAndBelow (index, getNumPrograms()))
+        return {};
+    return programs[static_cast<size_t> (index)].name;
 }
 
 void AudioPluginAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
-    juce::ignoreUnused (index, newName);
+    if (juce::isPositiveAndBelow (index, getNumPrograms()))
+        programs[static_cast<size_t> (index)].name = newName;
+}
+
+void AudioPluginAudioProcessor::buildPrograms()
+{
+    // every program starts from the defaults and leaves the input source alone
+    struct Setting { const char* id; float value; };
+    auto add = [this] (const juce::String& name, std::initializer_list<Setting> settings)
+    {
+        auto program = ParameterSnapshot::defaults (fxParams, treeState, name);
+        program.set (fxParams, inputSource.getName(), ParameterSnapshot::kKeep);
+        for (const auto& s : settings)
+            program.set (fxParams, s.id, s.value);
+        programs.push_back (std::move (program));
+    };
+
+    add ("Init", {});
+    add ("Slapback", { { "delayToggle", 1.f }, { "delayTime", 120.f }, { "delayFeedback", 0.1f }, { "delayBlend", 0.35f } });
+    add ("Wide Chorus", { { "chorusToggle", 1.f }, { "chorusRate", 0.8f }, { "chorusDepth", 30.f }, { "chorusBlend", 0.5f } });
+    add ("Squash", { { "compressorToggle", 1.f }, { "compressorThreshold", -24.f }, { "compressorRatio", 6.f },
+                     { "compressorMakeup", 8.f } });
+    add ("Big Room", { { "reverbToggle", 1.f }, { "reverbMode", 1.f }, { "reverbRoomLength", 80.f },
+                       { "reverbAbsorptionCoefficient", 0.3f }, { "reverbBlend", 0.4f } });
+    add ("Eighth Tremolo", { { "tremoloToggle", 1.f }, { "tremoloSync", 4.f }, { "tremoloDepth", 0.7f } });
+}
+
+void AudioPluginAudioProcessor::timerCallback()
+{
+    // push the program to the treeState once the audio thread has it, or after half a second
+    // without blocks (the host stopped calling processBlock)
+    const bool adopted = programSwitcher.getAdoptedCount() != adoptedAtPublish;
+    if (! adopted && ++syncTicks < 50)
+        return;
+
+    stopTimer();
+    programSwitcher.withdraw();
+    programs[static_cast<size_t> (currentProgram)].pushToTree (fxParams, treeState);
 }
 
 //==============================================================================
@@ -104,58 +267,72 @@ void AudioPluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPer
     // TODO: giml:SampleRateObserver
     // TODO: giml::EffectLine::addEffect() (encapsulation)
     int sr = static_cast<int>(sampleRate);
-
-    mChorus = std::make_unique<giml::Chorus<float>>(sr);
-    mChorus->setParams();
-    mEffectsLine.pushBack(mChorus.get());
-
-    mCompressor = std::make_unique<giml::Compressor<float>>(sr);
-    mCompressor->setParams();
-    mEffectsLine.pushBack(mCompressor.get());
-
-    mDelay = std::make_unique<giml::Delay<float>>(sr);
-    mDelay->setParams();
-    mEffectsLine.pushBack(mDelay.get());
-
-    mDetune = std::make_unique<giml::Detune<float>>(sr);
-    mDetune->setParams();
-    mEffectsLine.pushBack(mDetune.get());
-
-    mFlanger = std::make_unique<giml::Flanger<float>>(sr);
-    mFlanger->setParams();
-    mEffectsLine.pushBack(mFlanger.get());
-
-    mPhaser = std::make_unique<giml::Phaser<float>>(sr);
-    mPhaser->setParams();
-    mEffectsLine.pushBack(mPhaser.get());
-
-    mReverb = std::make_unique<giml::Reverb<float>>(sr);
-    mReverb->setParams(0.03f, 0.3f, 0.5f, 0.5f, 50.f, 0.9f); // needs defaults 
-    mEffectsLine.pushBack(mReverb.get());    
-
-    mTremolo = std::make_unique<giml::Tremolo<float>>(sr);
-    mTremolo->setParams();
-    mEffectsLine.pushBack(mTremolo.get());
-
-    mEnvelope = std::make_unique<giml::EnvelopeFilter<float>>(sr);
-    mEffectsLine.pushBack(mEnvelope.get());
-
-    // init mAudioVisualizerComponent
-    for (auto& scope : scopes) 
-    {
-        scope.setNumChannels(1);
-        scope.setSamplesPerBlock(samplesPerBlock);
-        scope.setBufferSize(static_cast<int>(sampleRate / samplesPerBlock));
-    }
-    scopes[1].setColours(juce::Colours::black, juce::Colours::blue);
-
-    juce::ignoreUnused (sampleRate, samplesPerBlock);
+    int numChannels = getTotalNumInputChannels(); // mono or stereo, see isBusesLayoutSupported
+    // Hosts prepare again on every rate or block size change and on transport resets, so every
+    // effect starts from silence here. The arena is reused, and so is the IR when nothing changed.
+    // Parameters reload from the treeState, dropping values automation or a program assigned
+    // ahead of it, so every prepare starts from the same state
+    fxParams.forEachParameter([](Parameter& param, int) { param.reload(); });
+    fxParams.prepare(sampleRate, samplesPerBlock); // smoothing ramps, settled at the current values
+    fxParams.markDirty();  // fresh instances need every param on the first block
+
+    mChorus.prepare(sr, numChannels, samplesPerBlock, static_cast<int>(chorusOversampling.load()));
+    mChorus.forEachLane([](auto& fx) { fx.setParams(); });
+
+    mCompressor.prepare(sr, numChannels, samplesPerBlock, static_cast<int>(compressorOversampling.load()));
+    mCompressor.forEachLane([](auto& fx) { fx.setParams(); });
+
+    mDelay.prepare(sr, numChannels);
+    mDelay.forEachLane([](auto& fx) { fx.setParams(); });
+
+    mDetune.prepare(sr, numChannels, samplesPerBlock, static_cast<int>(detuneOversampling.load()));
+    mDetune.forEachLane([](auto& fx) { fx.setParams(); });
+
+    mFlanger.prepare(sr, numChannels, samplesPerBlock, static_cast<int>(flangerOversampling.load()));
+    mFlanger.forEachLane([](auto& fx) { fx.setParams(); });
+
+    mPhaser.prepare(sr, numChannels);
+    mPhaser.forEachLane([](auto& fx) { fx.setParams(); });
+
+    mReverb.prepare(sr, numChannels);
+    mReverb.forEachLane([](auto& fx) { fx.setParams(0.03f, 0.3f, 0.5f, 0.5f, 50.f, 0.9f); }); // needs defaults 
+    // offline renders run faster than real time, so the IR's tail is convolved in processBlock
+    const bool irChanged = impulseNeeded.exchange(false);
+    if (mReverb.prepareConvolution(sampleRate, numChannels, samplesPerBlock, isNonRealtime()) || irChanged)
+        mReverb.setImpulseResponse(impulseMaker());
+
+    lfoBank.prepare(sampleRate, samplesPerBlock);
+    mTremolo.setParams();
+
+    mEnvelope.prepare(sr, numChannels);
+
+    mEffectsChain.prepare(sampleRate, samplesPerBlock);
+    programSwitcher.prepare(sampleRate);
+    automation.reset();
+    samplePosition = 0;
+    preparedToPlay = true;
+    filePlayer.prepare(sampleRate); // resamples the test file to the host rate
+    setLatencySamples(mEffectsChain.getLatencySamples()); // oversampling filters
+   #if GIMMEL_PROFILE
+    profiler.prepare(sampleRate, mEffectsChain.size());
+   #endif
 }
 
 void AudioPluginAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    preparedToPlay = false;
+    mChorus.release();
+    mCompressor.release();
+    mDelay.release();
+    mDetune.release();
+    mFlanger.release();
+    mPhaser.release();
+    mReverb.release();
+    mReverb.releaseConvolution();
+    mEnvelope.release();
+    mArena.release(); // the next prepareToPlay allocates it again
 }
 
 bool AudioPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -185,6 +362,8 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
 void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
+    GIMMEL_REALTIME_SECTION; // allocations and locks from here on are reported by GIMMEL-RTCHECK
+    GIMMEL_PROFILE_BLOCK(profiler, buffer.getNumSamples()); // per-effect timings with GIMMEL_PROFILE
     juce::ignoreUnused (midiMessages);
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -192,85 +371,54 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // update params at block rate
-    // TODO: giml::EffectLine::updateParams()
-    // ^This is non-trivial. The giml::Effect class would need a virtual function setParams()
-    // that supports a variable number of arguments & variable argument types.
-    mChorus->toggle(treeState.getRawParameterValue("chorusToggle")->load());
-    mChorus->setParams(treeState.getRawParameterValue("chorusRate")->load(),
-                       treeState.getRawParameterValue("chorusDepth")->load(),
-                       treeState.getRawParameterValue("chorusBlend")->load());
-
-    mCompressor->toggle(treeState.getRawParameterValue("compressorToggle")->load());
-    mCompressor->setParams(treeState.getRawParameterValue("compressorThreshold")->load(),
-                           treeState.getRawParameterValue("compressorRatio")->load(),
-                           treeState.getRawParameterValue("compressorMakeup")->load(),
-                           treeState.getRawParameterValue("compressorKnee")->load(),
-                           treeState.getRawParameterValue("compressorAttack")->load(),
-                           treeState.getRawParameterValue("compressorRelease")->load());
-    
-    mDelay->toggle(treeState.getRawParameterValue("delayToggle")->load());
-    mDelay->setParams(treeState.getRawParameterValue("delayTime")->load(),
-                      treeState.getRawParameterValue("delayFeedback")->load(),
-                      treeState.getRawParameterValue("delayDamping")->load(),
-                      treeState.getRawParameterValue("delayBlend")->load());
-
-    mDetune->toggle(treeState.getRawParameterValue("detuneToggle")->load());
-    mDetune->setParams(treeState.getRawParameterValue("detunePitchRatio")->load(),
-                       treeState.getRawParameterValue("detuneWindowSize")->load(),
-                       treeState.getRawParameterValue("detuneBlend")->load());
-
-    mFlanger->toggle(treeState.getRawParameterValue("flangerToggle")->load());
-    mFlanger->setParams(treeState.getRawParameterValue("flangerRate")->load(),
-                        treeState.getRawParameterValue("flangerDepth")->load(),
-                        treeState.getRawParameterValue("flangerBlend")->load());
-
-    mPhaser->toggle(treeState.getRawParameterValue("phaserToggle")->load());
-    mPhaser->setParams(treeState.getRawParameterValue("phaserRate")->load(),
-                       treeState.getRawParameterValue("phaserFeedback")->load());
-
-    mReverb->toggle(treeState.getRawParameterValue("reverbToggle")->load());
-    mReverb->setParams(treeState.getRawParameterValue("reverbTime")->load(),
-                       treeState.getRawParameterValue("reverbRegen")->load(),
-                       treeState.getRawParameterValue("reverbDamping")->load(),
-                       treeState.getRawParameterValue("reverbBlend")->load(),
-                       treeState.getRawParameterValue("reverbRoomLength")->load(),
-                       treeState.getRawParameterValue("reverbAbsorptionCoefficient")->load(),
-                       static_cast<giml::Reverb<float>::RoomType>(treeState.getRawParameterValue("reverbRoomType")->load()));
-
-    mTremolo->toggle(treeState.getRawParameterValue("tremoloToggle")->load());
-    mTremolo->setParams(treeState.getRawParameterValue("tremoloSpeed")->load(),
-                        treeState.getRawParameterValue("tremoloDepth")->load());
-
-    mEnvelope->toggle(treeState.getRawParameterValue("envelopeToggle")->load());
-    mEnvelope->setParams(treeState.getRawParameterValue("envelopeQFactor")->load(), 
-                         treeState.getRawParameterValue("envelopeAttackMs")->load(), 
-                         treeState.getRawParameterValue("envelopeReleaseMs")->load());
-
-    // sample loop
-    for (int sample = 0; sample < buffer.getNumSamples(); sample++) {
-
-        const float* input = buffer.getReadPointer(0, sample); // option for real-time input
-        // const float* input = &wav_data[playHead]; // read from looping file
-        playHead++;                        
-        if (playHead >= wav_data_len) { playHead = 0; }
-
-        // feed input scope
-        scopes[0].pushSample(input, 1);
-
-        // calculate output sample
-        float out = mEffectsLine.processSample(*input);
-
-        // write output to all channels
-        for (int channel = 0; channel < totalNumInputChannels; channel++) 
-        {
-            buffer.getWritePointer(channel)[sample] = out;
-        }
-
-        // feed output scope
-        const float* output = buffer.getReadPointer(0, sample);
-        scopes[1].pushSample(output, 1);
+    // program changes: every parameter switches at once, at the bottom of a short dip
+    if (auto* program = programSwitcher.beginBlock())
+        fxParams.assign (program->values);
+
+    // block loop: one pass per effect over the whole buffer, every channel with its own state.
+    // The chain pushes params to an effect only when they moved, per sub-block while smoothing
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin (totalNumInputChannels, buffer.getNumChannels(), kMaxChannels);
+    float* const* channels = buffer.getArrayOfWritePointers();
+
+    // read from looping file, real-time input otherwise
+    inputSource.poll();
+    if (inputSource.getIndex() == 1)
+        filePlayer.read(channels, numChannels, numSamples);
+
+    // feed input scope
+    scopeFeed.push(ScopeFeed::Input, channels[0], numSamples);
+    analyzer.push(SpectrumAnalyzer::Input, channels[0], numSamples);
+
+    // calculate output block, in chunks the LFO bank was prepared for: each chunk's LFOs are
+    // rendered in one pass before the chain reads them. Timestamped automation splits chunks
+    // further, at the grid point each change falls on, so the chain sees it in time
+    const auto transport = LfoBank::getTransport (getPlayHead());
+    const int chunkSize = lfoBank.getMaxBlockSize();
+    float* chunk[kMaxChannels];
+    for (int start = 0; start < numSamples;)
+    {
+        const juce::int64 position = samplePosition + start;
+        automation.applyDue (position, [this] (const AutomationQueue::Event& e) {
+            automationTargets[static_cast<size_t> (e.param)]->assign (e.value);
+        });
+        const int length = static_cast<int> (juce::jmin<juce::int64> (juce::jmin (chunkSize, numSamples - start),
+                                                                      automation.nextTime() - position));
+        for (int ch = 0; ch < numChannels; ++ch)
+            chunk[ch] = channels[ch] + start;
+
+        mTremolo.updateLfo (transport.advancedBy (start, getSampleRate()));
+        lfoBank.process (length);
+        mEffectsChain.processBlock (chunk, chunk, numChannels, length);
+        start += length;
     }
+    samplePosition += numSamples;
+
+    programSwitcher.applyFade (channels, numChannels, numSamples);
+
+    // feed output scope
+    scopeFeed.push(ScopeFeed::Output, channels[0], numSamples);
+    analyzer.push(SpectrumAnalyzer::Output, channels[0], numSamples);
 }
 
 //==============================================================================
@@ -287,17 +435,159 @@ juce::AudioProcessorEditor* AudioPluginAudioProcessor::createEditor()
 //==============================================================================
 void AudioPluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    juce::ignoreUnused (destData);
+    // compact binary, written straight from the ParameterStack (see StateFormat)
+    StateFormat::State state;
+    state.order = getEffectOrder();
+    state.program = currentProgram;
+    state.irPath = irFileSource.getFullPathName();
+    StateFormat::write (destData, fxParams, state);
 }
 
 void AudioPluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    juce::ignoreUnused (data, sizeInBytes);
+    auto values = ParameterSnapshot::capture (fxParams);
+    StateFormat::State state;
+    if (! StateFormat::read (data, sizeInBytes, fxParams, values, state))
+        return;
+
+    values.pushToTree (fxParams, treeState);
+    if (state.hasOrder)
+        setEffectOrder (state.order);
+    currentProgram = juce::jlimit (0, getNumPrograms() - 1, state.program);
+    if (state.irPath.isNotEmpty() && juce::File::isAbsolutePath (state.irPath))
+        loadImpulseResponse (juce::File (state.irPath));
+}
+
+//==============================================================================
+juce::StringArray AudioPluginAudioProcessor::getEffectNames() const
+{
+    // pushBack order in prepareToPlay
+    return { "Chorus", "Compressor", "Delay", "Detune", "Flanger", "Phaser", "Reverb", "Tremolo", "Envelope" };
+}
+
+std::vector<int> AudioPluginAudioProcessor::getEffectOrder() const
+{
+    return mEffectsChain.getOrder();
+}
+
+void AudioPluginAudioProcessor::setEffectOrder (const std::vector<int>& order)
+{
+    // builds the new order here and publishes it with an atomic swap, the audio thread
+    // never waits and the effects keep their delay lines and reverb tails
+    mEffectsChain.setOrder(order);
+    setLatencySamples(mEffectsChain.getLatencySamples());
+}
+
+void AudioPluginAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    // may arrive on the audio thread, the work happens on the message thread
+    juce::ignoreUnused (newValue);
+    if (containsParameter (oversamplingParams, parameterID))
+        reprepareNeeded.store (true);
+    if (containsParameter (impulseParams, parameterID))
+        impulseNeeded.store (true);
+    tailNeeded.store (true);
+    triggerAsyncUpdate();
+}
+
+void AudioPluginAudioProcessor::handleAsyncUpdate()
+{
+    if (getSampleRate() <= 0.0)
+        return; // picked up by the first prepareToPlay
+
+    // an oversampling factor changed: rebuild that effect at its new rate. It restarts from
+    // silence, so this is a setup change rather than something to automate
+    if (reprepareNeeded.exchange (false))
+    {
+        suspendProcessing (true);
+        updateOversampling();
+        suspendProcessing (false);
+    }
+
+    // the convolution IR is rebuilt on the reverb's builder thread once the change settles,
+    // and crossfaded in while audio runs
+    if (impulseNeeded.exchange (false))
+        mReverb.requestImpulseResponse (impulseMaker(), kImpulseDebounceMs);
+
+    // hosts may ask for the tail on any thread, so it's cached rather than computed there
+    if (tailNeeded.exchange (false))
+        mEffectsChain.updateTail();
+}
+
+void AudioPluginAudioProcessor::updateOversampling()
+{
+    // only the slots whose factor changed are rebuilt; the rest of the chain, the transport
+    // position, automation and smoothing carry on as they were
+    const int sr = static_cast<int> (getSampleRate());
+    const int numChannels = getTotalNumInputChannels();
+    auto rebuild = [&] (auto& slot, Parameter& factor) {
+        const int order = static_cast<int> (factor.load());
+        if (slot.getFactor() == 1 << order)
+            return;
+        slot.prepare (sr, numChannels, getBlockSize(), order);
+        slot.forEachLane ([] (auto& fx) { fx.setParams(); });
+        slot.getParams()->markDirty(); // the new instances need every param on the next block
+        mEffectsChain.stageChanged (slot);
+    };
+    rebuild (mChorus, chorusOversampling);
+    rebuild (mCompressor, compressorOversampling);
+    rebuild (mDetune, detuneOversampling);
+    rebuild (mFlanger, flangerOversampling);
+    setLatencySamples (mEffectsChain.getLatencySamples());
+}
+
+bool AudioPluginAudioProcessor::loadImpulseResponse (const juce::File& file)
+{
+    juce::AudioBuffer<float> ir;
+    double rate = 0.0;
+    if (! ImpulseResponse::load (file, ir, rate))
+        return false;
+
+    irFile = std::make_shared<const juce::AudioBuffer<float>> (std::move (ir));
+    irFileRate = rate;
+    irFileName = file.getFileName();
+    irFileSource = file;
+    mReverb.requestImpulseResponse (impulseMaker(), 0);
+    return true;
+}
+
+bool AudioPluginAudioProcessor::scheduleParameterChange (const juce::String& parameterID, float value, juce::int64 time)
+{
+    if (isSetupParameter (parameterID))
+        return false; // assigned on the audio thread, it would never reach parameterChanged
+
+    for (size_t i = 0; i < automationTargets.size(); ++i)
+    {
+        if (parameterID == juce::String (automationTargets[i]->getName()))
+            return automation.push ({ static_cast<int> (i), value, time });
+    }
+    return false;
+}
+
+bool AudioPluginAudioProcessor::isSetupParameter (const juce::String& parameterID) const
+{
+    return containsParameter (oversamplingParams, parameterID) || containsParameter (impulseParams, parameterID);
+}
+
+ImpulseResponse::Maker AudioPluginAudioProcessor::impulseMaker() const
+{
+    // "Convolution (file)" plays the loaded IR, "Convolution (room)" (or a file mode with no
+    // file yet) synthesizes one from the room model's parameters. The parameters are read
+    // here, the IR is built wherever the maker runs
+    const int mode = static_cast<int> (reverbMode.load());
+    if (mode == 0)
+        return {};
+
+    if (mode == 2 && irFile != nullptr)
+        return [ir = irFile, rate = irFileRate] (double sampleRate) { return ImpulseResponse::resample (*ir, rate, sampleRate); };
+
+    ImpulseResponse::Room room;
+    room.type = static_cast<int> (reverbRoomType.load());
+    room.length = reverbRoomLength.load();
+    room.absorption = reverbAbsorptionCoefficient.load();
+    room.damping = reverbDamping.load();
+    room.customTime = reverbTime.load();
+    return [room] (double sampleRate) { return ImpulseResponse::synthesize (room, sampleRate); };
 }
 
 //==============================================================================
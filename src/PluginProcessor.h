@@ -4,10 +4,24 @@
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "../include/Gimmel/include/gimmel.hpp"
 #include "Parameters.hpp"
-#include "../media/test.h"
+#include "EffectsChain.hpp"
+#include "Oversampling.hpp"
+#include "LfoBank.hpp"
+#include "Tremolo.hpp"
+#include "ConvolutionReverb.hpp"
+#include "PresetBank.hpp"
+#include "Automation.hpp"
+#include "RealtimeCheck.hpp"
+#include "Profiler.hpp"
+#include "ScopeFeed.hpp"
+#include "SpectrumAnalyzer.hpp"
+#include "FilePlayer.hpp"
 
 //==============================================================================
-class AudioPluginAudioProcessor final : public juce::AudioProcessor
+class AudioPluginAudioProcessor final : public juce::AudioProcessor,
+                                        private juce::AudioProcessorValueTreeState::Listener,
+                                        private juce::AsyncUpdater,
+                                        private juce::Timer
 {
 public:
     //==============================================================================
@@ -46,14 +60,58 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    // input, output, and spectral scopes
-    static const size_t numScopes = 2;
-    juce::AudioVisualiserComponent scopes[2] { { 1 }, { 1 } };
+    //==============================================================================
+    // Chain order, safe to change from the message thread while audio is running.
+    // Indices refer to getEffectNames(); effects left out are removed from the line
+    juce::StringArray getEffectNames() const;
+    std::vector<int> getEffectOrder() const;
+    void setEffectOrder (const std::vector<int>& order);
+
+    // Impulse response for the reverb's "Convolution (file)" mode. Message thread only;
+    // returns false if the file can't be read
+    bool loadImpulseResponse (const juce::File& file);
+    juce::String getImpulseResponseName() const { return irFileName; }
+
+    // Sample-accurate automation for callers that drive processBlock themselves, e.g.
+    // GIMMEL-RENDER. `time` is in samples since prepareToPlay; push in time order from one
+    // thread. Returns false for an unknown ID, a setup parameter or a full queue. Host
+    // automation still arrives through the treeState, once per block
+    bool scheduleParameterChange (const juce::String& parameterID, float value, juce::int64 time);
+
+    // Oversampling factors and the reverb's mode and room: they rebuild effects on the message
+    // thread when the treeState changes, so they can't be scheduled
+    bool isSetupParameter (const juce::String& parameterID) const;
+
+    // Does the message-thread work treeState changes left pending (the tail, rebuilds) now,
+    // for callers with no message loop
+    void handlePendingChanges() { handleUpdateNowIfNeeded(); }
+
+    // input and output signals for the editor's scopes, written only while an editor is open
+    ScopeFeed scopeFeed;
+
+    // input and output spectra, computed on a background thread while an editor is open
+    SpectrumAnalyzer analyzer;
+
+   #if GIMMEL_PROFILE
+    // per-effect timings, read by the editor
+    ChainProfiler profiler;
+   #endif
+
+    // test signal: a looping file in place of the live input
+    FilePlayer filePlayer;
+    ParameterChoice inputSource { "inputSource", juce::StringArray{"Live", "File"}, 0 };
+
+    // oversampling factors for the effects that alias; changing one re-prepares the chain
+    const juce::StringArray oversamplingChoices { "1x", "2x", "4x", "8x" };
+
+    // free-running rate or a note value of the host tempo, for LFO-driven effects
+    const juce::StringArray syncChoices = LfoBank::getSyncChoices();
 
     ParameterBool chorusToggle { "chorusToggle" };
     ParameterFloat chorusRate { "chorusRate", 0.f, 20.f, 0.2f };
     ParameterFloat chorusDepth { "chorusDepth", 0.f, 50.f, 20.f };
     ParameterFloat chorusBlend { "chorusBlend", 0.f, 1.f, 0.5f };
+    ParameterChoice chorusOversampling { "chorusOversampling", oversamplingChoices, 0 };
 
     ParameterBool compressorToggle { "compressorToggle" };
     ParameterFloat compressorThreshold { "compressorThreshold", -60.f, 0.f, 0.f };
@@ -62,6 +120,7 @@ public:
     ParameterFloat compressorKnee { "compressorKnee", 0.f, 5.f, 1.f };
     ParameterFloat compressorAttack { "compressorAttack", 0.f, 10.f, 3.5f };
     ParameterFloat compressorRelease { "compressorRelease", 0.f, 300.f, 100.f };
+    ParameterChoice compressorOversampling { "compressorOversampling", oversamplingChoices, 0 };
 
     ParameterBool delayToggle { "delayToggle" };
     ParameterFloat delayTime { "delayTime", 0.f, 3000.f, 398.f };
@@ -73,11 +132,13 @@ public:
     ParameterFloat detunePitchRatio { "detunePitchRatio", 0.5f, 2.f, 1.f };
     ParameterFloat detuneWindowSize { "detuneWindowSize", 0.f, 300.f, 22.f };
     ParameterFloat detuneBlend { "detuneBlend", 0.f, 1.f, 0.5f };
+    ParameterChoice detuneOversampling { "detuneOversampling", oversamplingChoices, 0 };
 
     ParameterBool flangerToggle { "flangerToggle" };
     ParameterFloat flangerRate { "flangerRate", 0.f, 20.f, 0.2f };
     ParameterFloat flangerDepth { "flangerDepth", 0.f, 10.f, 5.f };
     ParameterFloat flangerBlend { "flangerBlend", 0.f, 1.f, 0.5f };
+    ParameterChoice flangerOversampling { "flangerOversampling", oversamplingChoices, 0 };
 
     ParameterBool phaserToggle { "phaserToggle" };
     ParameterFloat phaserRate { "phaserRate", 0.f, 20.f, 0.5f };
@@ -91,10 +152,12 @@ public:
     ParameterFloat reverbRoomLength { "reverbRoomLength", 1.f, 100.f, 50.f };
     ParameterFloat reverbAbsorptionCoefficient { "reverbAbsorptionCoefficient", 0.f, 1.f, 0.9f };
     ParameterChoice reverbRoomType { "reverbRoomType", juce::StringArray{"Cube", "Sphere", "Square Pyramid", "Cylinder", "Custom"}, 0 };
+    ParameterChoice reverbMode { "reverbMode", juce::StringArray{"Algorithmic", "Convolution (room)", "Convolution (file)"}, 0 };
 
     ParameterBool tremoloToggle { "tremoloToggle" };
     ParameterFloat tremoloRate { "tremoloSpeed", 10.f, 2000.f, 1000.f };
     ParameterFloat tremoloDepth { "tremoloDepth", 0.f, 1.f, 0.5f };
+    ParameterChoice tremoloSync { "tremoloSync", syncChoices, 0 };
 
     ParameterBool envelopeToggle { "envelopeToggle" };
     ParameterFloat envelopeQFactor { "envelopeQFactor", 0.1f, 20.f, 5.f };
@@ -102,18 +165,20 @@ public:
     ParameterFloat envelopeReleaseMs { "envelopeReleaseMs", 0.f, 2000.f, 1105.f };
 
     // Bundles are useful for grouping by effect to add tabs to the GUI
-    ParameterBundle chorusParams{ &chorusToggle, &chorusRate, &chorusDepth, &chorusBlend };
-    ParameterBundle compressorParams{ &compressorToggle, &compressorThreshold, &compressorRatio, &compressorMakeup, &compressorKnee, &compressorAttack, &compressorRelease }; 
+    ParameterBundle inputParams{ &inputSource };
+    ParameterBundle chorusParams{ &chorusToggle, &chorusRate, &chorusDepth, &chorusBlend, &chorusOversampling };
+    ParameterBundle compressorParams{ &compressorToggle, &compressorThreshold, &compressorRatio, &compressorMakeup, &compressorKnee, &compressorAttack, &compressorRelease, &compressorOversampling }; 
     ParameterBundle delayParams{ &delayToggle, &delayTime, &delayFeedback, &delayDamping, &delayBlend };
-    ParameterBundle detuneParams{ &detuneToggle, &detunePitchRatio, &detuneWindowSize, &detuneBlend };
-    ParameterBundle flangerParams{ &flangerToggle, &flangerRate, &flangerDepth, &flangerBlend };
+    ParameterBundle detuneParams{ &detuneToggle, &detunePitchRatio, &detuneWindowSize, &detuneBlend, &detuneOversampling };
+    ParameterBundle flangerParams{ &flangerToggle, &flangerRate, &flangerDepth, &flangerBlend, &flangerOversampling };
     ParameterBundle phaserParams{ &phaserToggle, &phaserRate, &phaserFeedback };
-    ParameterBundle reverbParams{ &reverbToggle, &reverbTime, &reverbRegen, &reverbDamping, &reverbBlend, &reverbRoomLength, &reverbAbsorptionCoefficient, &reverbRoomType };
-    ParameterBundle tremoloParams{ &tremoloToggle, &tremoloRate, &tremoloDepth };
+    ParameterBundle reverbParams{ &reverbToggle, &reverbTime, &reverbRegen, &reverbDamping, &reverbBlend, &reverbRoomLength, &reverbAbsorptionCoefficient, &reverbRoomType, &reverbMode };
+    ParameterBundle tremoloParams{ &tremoloToggle, &tremoloRate, &tremoloDepth, &tremoloSync };
     ParameterBundle envelopeParams{ &envelopeToggle, &envelopeQFactor, &envelopeAttackMs, &envelopeReleaseMs };
 
     // Stack is useful for adding to the treeState
-    ParameterStack fxParams{ &chorusParams, 
+    ParameterStack fxParams{ &inputParams,
+                            &chorusParams, 
                             &compressorParams, 
                             &delayParams, 
                             &detuneParams, 
@@ -128,20 +193,55 @@ public:
     
 
 private:
-    //==============================================================================    // giml effects
-    giml::EffectsLine<float> mEffectsLine;
-    std::unique_ptr<giml::Chorus<float>> mChorus;
-    std::unique_ptr<giml::Compressor<float>> mCompressor;
-    std::unique_ptr<giml::Delay<float>> mDelay;
-    std::unique_ptr<giml::Detune<float>> mDetune;
-    std::unique_ptr<giml::Flanger<float>> mFlanger;
-    std::unique_ptr<giml::Phaser<float>> mPhaser;
-    std::unique_ptr<giml::Reverb<float>> mReverb;
-    std::unique_ptr<giml::Tremolo<float>> mTremolo;
-    std::unique_ptr<giml::EnvelopeFilter<float>> mEnvelope;
-
-    // for wavfile
-    int playHead = 0;
+    //==============================================================================    // giml effects, one instance per channel
+    EffectsChain mEffectsChain;
+    LfoBank lfoBank; // modulation for every LFO-driven stage, rendered once per block
+    EffectArena mArena; // every effect instance below lives here, declared first so it outlives them
+    OversampledSlot<giml::Chorus<float>> mChorus;
+    OversampledSlot<giml::Compressor<float>> mCompressor;
+    EffectSlot<giml::Delay<float>> mDelay;
+    OversampledSlot<giml::Detune<float>> mDetune;
+    OversampledSlot<giml::Flanger<float>> mFlanger;
+    EffectSlot<giml::Phaser<float>> mPhaser;
+    ReverbSlot mReverb; // giml::Reverb or the convolution, by reverbMode
+    TremoloStage mTremolo; // driven by lfoBank, no giml instance
+    EffectSlot<giml::EnvelopeFilter<float>> mEnvelope;
+
+    // Setup changes applied on the message thread: oversampling rebuilds the effects, the
+    // reverb's mode and room rebuild the convolution IR
+    const std::vector<Parameter*> oversamplingParams { &chorusOversampling, &compressorOversampling, &detuneOversampling, &flangerOversampling };
+    const std::vector<Parameter*> impulseParams { &reverbMode, &reverbRoomType, &reverbRoomLength, &reverbAbsorptionCoefficient,
+                                                  &reverbDamping, &reverbTime };
+    std::atomic<bool> reprepareNeeded { false };
+    std::atomic<bool> impulseNeeded { false };
+    std::atomic<bool> tailNeeded { false };
+    static constexpr int kImpulseDebounceMs = 150; // room changes build one IR once they settle
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    void updateOversampling();
+
+    std::shared_ptr<const juce::AudioBuffer<float>> irFile; // shared with the IR builder's requests
+    double irFileRate = 0.0;
+    juce::String irFileName;
+    juce::File irFileSource;
+    ImpulseResponse::Maker impulseMaker() const; // the current mode's IR, empty for giml::Reverb
+
+    // Factory programs. A switch is published to the audio thread, which applies it in one
+    // block; the timer then brings the treeState in line
+    std::vector<ParameterSnapshot> programs;
+    int currentProgram = 0;
+    ProgramSwitcher programSwitcher;
+    uint32_t adoptedAtPublish = 0;
+    int syncTicks = 0;
+    std::atomic<bool> preparedToPlay { false };
+
+    // timestamped changes, applied where they fall by splitting the block
+    AutomationQueue automation;
+    std::vector<Parameter*> automationTargets; // fxParams in forEachParameter order
+    juce::int64 samplePosition = 0;            // since prepareToPlay
+
+    void buildPrograms();
+    void timerCallback() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessor)
 };
@@ -0,0 +1,213 @@
+//====================================================================================================
+/* PresetBank.hpp
+
+Programs and plugin state without the XML round-trip. A program is a complete snapshot of the
+ParameterStack's values, built on the message thread; switching programs hands the audio thread
+a pointer to it. The audio thread dips the output over kFadeMs, assigns every value at the
+bottom of the dip, and fades back in, so a switch is one atomic swap rather than a stream of
+treeState notifications landing over several blocks. The treeState catches up afterwards.
+
+State is a small versioned binary blob: parameter values keyed by ID (so parameters can be
+added or removed between versions), the chain order, the current program and the IR file.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "Parameters.hpp"
+#include "SharedTables.hpp"
+
+// one value per parameter, in ParameterStack::forEachParameter order
+struct ParameterSnapshot {
+  // a value that leaves its parameter as it is
+  static constexpr float kKeep = std::numeric_limits<float>::quiet_NaN();
+
+  juce::String name;
+  std::vector<float> values;
+
+  // the treeState's current values (message thread)
+  static ParameterSnapshot capture(ParameterStack& params, const juce::String& name = {}) {
+    ParameterSnapshot s;
+    s.name = name;
+    s.values.resize(static_cast<size_t>(params.getNumParameters()));
+    params.forEachParameter([&s](Parameter& p, int i) { s.values[static_cast<size_t>(i)] = p.load(); });
+    return s;
+  }
+
+  // every parameter at its default
+  static ParameterSnapshot defaults(ParameterStack& params, APVTS& treeState, const juce::String& name = {}) {
+    ParameterSnapshot s = capture(params, name);
+    params.forEachParameter([&s, &treeState](Parameter& p, int i) {
+      if (auto* rp = treeState.getParameter(p.getName())) {
+        s.values[static_cast<size_t>(i)] = rp->convertFrom0to1(rp->getDefaultValue());
+      }
+    });
+    return s;
+  }
+
+  // sets the value of the parameter with ID `id`, if there is one
+  void set(ParameterStack& params, const juce::String& id, float value) {
+    params.forEachParameter([this, &id, value](Parameter& p, int i) {
+      if (id == juce::String(p.getName())) { this->values[static_cast<size_t>(i)] = value; }
+    });
+  }
+
+  // Pushes the values that differ into the treeState (message thread). Hosts and the GUI see
+  // them as ordinary parameter changes
+  void pushToTree(ParameterStack& params, APVTS& treeState) const {
+    params.forEachParameter([this, &treeState](Parameter& p, int i) {
+      const float v = this->values[static_cast<size_t>(i)];
+      auto* rp = treeState.getParameter(p.getName());
+      if (rp != nullptr && !std::isnan(v) && p.load() != v) { rp->setValueNotifyingHost(rp->convertTo0to1(v)); }
+    });
+  }
+};
+
+// Hands program snapshots to the audio thread at the bottom of a short dip in the output
+class ProgramSwitcher {
+public:
+  static constexpr double kFadeMs = 10.0;
+
+private:
+  enum class Fade { None, Out, In };
+
+  std::atomic<const ParameterSnapshot*> pending { nullptr };
+  std::atomic<uint32_t> adopted { 0 };
+  const ParameterSnapshot* next = nullptr; // taken from pending, applied when the dip bottoms out
+  Fade fade = Fade::None;
+  SharedTable gains; // equal-power, read forwards as the output comes back
+  int fadeLength = 1;
+  int fadePos = 0;
+
+public:
+  ProgramSwitcher() {}
+  ~ProgramSwitcher() {}
+
+  void prepare(double sampleRate) {
+    this->gains = SharedTables::equalPowerFade(sampleRate, kFadeMs);
+    this->fadeLength = static_cast<int>(this->gains->size()) - 1;
+    this->fadePos = this->fadeLength;
+    this->fade = Fade::None;
+    if (this->next != nullptr) { // a dip was cut short, switch without it
+      this->pending.store(this->next);
+      this->next = nullptr;
+    }
+  }
+
+  //==============================================================================
+  // message thread
+
+  // `snapshot` must stay alive and unchanged until it's adopted; a newer publish replaces it
+  void publish(const ParameterSnapshot& snapshot) { this->pending.store(&snapshot); }
+
+  // drops a snapshot the audio thread hasn't taken yet, e.g. when it isn't running
+  bool withdraw() { return this->pending.exchange(nullptr) != nullptr; }
+
+  // incremented each time the audio thread applies a snapshot
+  uint32_t getAdoptedCount() const { return this->adopted.load(); }
+
+  //==============================================================================
+  // audio thread
+
+  // Call at the start of each block. Returns the snapshot to apply to the parameters now
+  const ParameterSnapshot* beginBlock() {
+    if (this->fade == Fade::None) {
+      if (const ParameterSnapshot* s = this->pending.exchange(nullptr)) {
+        this->next = s;
+        this->fade = Fade::Out;
+      }
+      return nullptr;
+    }
+    if (this->fade == Fade::Out && this->fadePos == 0) {
+      const ParameterSnapshot* s = this->next;
+      this->next = nullptr;
+      this->fade = Fade::In;
+      this->adopted.fetch_add(1);
+      return s;
+    }
+    return nullptr;
+  }
+
+  // call on the chain's output; silent at the bottom of the dip until the next block
+  void applyFade(float* const* channels, int numChannels, int numSamples) {
+    if (this->fade == Fade::None) { return; }
+    const float* table = this->gains->data();
+    const int step = this->fade == Fade::Out ? -1 : 1;
+    int pos = this->fadePos;
+    for (int i = 0; i < numSamples; i++) {
+      pos = juce::jlimit(0, this->fadeLength, pos + step);
+      for (int ch = 0; ch < numChannels; ch++) { channels[ch][i] *= table[pos]; }
+    }
+    this->fadePos = pos;
+    if (this->fade == Fade::In && pos == this->fadeLength) { this->fade = Fade::None; }
+  }
+};
+
+// The binary state format. Version 1:
+//   magic "GIMS", version, parameter count, (ID, value) pairs, order count, order indices,
+//   current program, IR file path
+namespace StateFormat {
+  constexpr int kMagic = 0x534d4947; // "GIMS" little-endian
+  constexpr int kVersion = 1;
+
+  struct State {
+    std::vector<int> order;
+    bool hasOrder = false; // false when the blob ends before its order section
+    int program = 0;
+    juce::String irPath;
+  };
+
+  inline void write(juce::MemoryBlock& dest, ParameterStack& params, const State& state) {
+    juce::MemoryOutputStream out(dest, false);
+    out.writeInt(kMagic);
+    out.writeInt(kVersion);
+    out.writeInt(params.getNumParameters());
+    params.forEachParameter([&out](Parameter& p, int) {
+      out.writeString(juce::String(p.getName()));
+      out.writeFloat(p.load());
+    });
+    out.writeInt(static_cast<int>(state.order.size()));
+    for (int index : state.order) { out.writeInt(index); }
+    out.writeInt(state.program);
+    out.writeString(state.irPath);
+  }
+
+  // Fills `values` (which should hold the current values) with the stored ones, matched by ID;
+  // parameters the blob doesn't mention keep theirs, and `state.order` is only valid with
+  // `state.hasOrder`. Returns false if it isn't our state
+  inline bool read(const void* data, int size, ParameterStack& params, ParameterSnapshot& values, State& state) {
+    juce::MemoryInputStream in(data, static_cast<size_t>(juce::jmax(0, size)), false);
+    if (size < 12 || in.readInt() != kMagic) { return false; }
+    const int version = in.readInt();
+    if (version < 1 || version > kVersion) { return false; }
+
+    const int numParams = in.readInt();
+    for (int i = 0; i < numParams && !in.isExhausted(); i++) {
+      const juce::String id = in.readString();
+      const float value = in.readFloat();
+      values.set(params, id, value);
+    }
+
+    // A blob cut short here keeps the current order: an empty order is a valid, empty chain,
+    // and a damaged session shouldn't read as one
+    state.order.clear();
+    state.hasOrder = false;
+    const auto remaining = [&in] { return in.getNumBytesRemaining(); };
+    if (remaining() < 4) { return true; }
+    const int numOrder = in.readInt();
+    if (numOrder < 0 || remaining() < static_cast<juce::int64>(numOrder) * 4) { return true; }
+    for (int i = 0; i < numOrder; i++) { state.order.push_back(in.readInt()); }
+    state.hasOrder = true;
+
+    if (remaining() >= 4) { state.program = in.readInt(); }
+    state.irPath = in.readString();
+    return true;
+  }
+} // namespace StateFormat
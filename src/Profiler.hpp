@@ -0,0 +1,261 @@
+//====================================================================================================
+/* Profiler.hpp
+
+Per-effect CPU timing, compiled in with GIMMEL_PROFILE (cmake -DGIMMEL_PROFILE=ON). The audio
+thread timestamps each stage of the chain and pushes one ProfileFrame per block into a
+LockFreeRing; the editor drains the ring, keeps min/mean/max per effect and the share of the
+block deadline, and can export the table as CSV.
+
+Without GIMMEL_PROFILE the GIMMEL_PROFILE_* macros expand to nothing and none of the classes
+below exist, so release builds carry no timing code at all.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#ifndef GIMMEL_PROFILE
+  #define GIMMEL_PROFILE 0
+#endif
+
+#if GIMMEL_PROFILE
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <juce_audio_utils/juce_audio_utils.h>
+#include "LockFreeRing.hpp"
+
+constexpr int kMaxProfiledStages = 16;
+
+// One processBlock call. Stage times are indexed by the stage's pushBack order
+struct ProfileFrame {
+  int numStages = 0;
+  float stageMicros[kMaxProfiledStages] = {};
+  float blockMicros = 0.f;    // the whole processBlock, scopes included
+  float deadlineMicros = 0.f; // duration of the block's audio
+};
+
+// Audio thread side: the frame being built, and the ring it is published to
+class ChainProfiler {
+private:
+  LockFreeRing<ProfileFrame> frames;
+  ProfileFrame frame;
+  juce::int64 blockStart = 0;
+  double microsPerTick = 1.0;
+  double sampleRate = 44100.0;
+
+public:
+  // the ring is sized once: an open editor may be popping from it while the host re-prepares
+  ChainProfiler() { this->frames.prepare(512); } // a few seconds of blocks between editor refreshes
+  ~ChainProfiler() {}
+
+  void prepare(double sampleRate, int numStages) {
+    this->sampleRate = sampleRate;
+    this->microsPerTick = 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    this->frame = ProfileFrame{};
+    this->frame.numStages = std::min(numStages, kMaxProfiledStages);
+  }
+
+  void beginBlock(int numSamples) {
+    std::fill(std::begin(this->frame.stageMicros), std::end(this->frame.stageMicros), 0.f);
+    this->frame.deadlineMicros = static_cast<float>(1.0e6 * numSamples / this->sampleRate);
+    this->blockStart = juce::Time::getHighResolutionTicks();
+  }
+
+  // a stage may run several times per block (oversized blocks are split), times add up
+  void addStage(int index, juce::int64 ticks) {
+    if (index >= 0 && index < this->frame.numStages) {
+      this->frame.stageMicros[index] += static_cast<float>(ticks * this->microsPerTick);
+    }
+  }
+
+  // drops the frame if the editor hasn't kept up
+  void endBlock() {
+    this->frame.blockMicros = static_cast<float>((juce::Time::getHighResolutionTicks() - this->blockStart) * this->microsPerTick);
+    this->frames.push(this->frame);
+  }
+
+  // GUI thread
+  int pop(ProfileFrame* dest, int count) { return this->frames.pop(dest, count); }
+};
+
+class ScopedStageTimer {
+private:
+  ChainProfiler* profiler;
+  int index;
+  juce::int64 start;
+
+public:
+  ScopedStageTimer(ChainProfiler* p, int stageIndex)
+      : profiler(p), index(stageIndex), start(juce::Time::getHighResolutionTicks()) {}
+  ~ScopedStageTimer() {
+    if (this->profiler != nullptr) {
+      this->profiler->addStage(this->index, juce::Time::getHighResolutionTicks() - this->start);
+    }
+  }
+};
+
+class ScopedBlockTimer {
+private:
+  ChainProfiler& profiler;
+
+public:
+  ScopedBlockTimer(ChainProfiler& p, int numSamples) : profiler(p) { this->profiler.beginBlock(numSamples); }
+  ~ScopedBlockTimer() { this->profiler.endBlock(); }
+};
+
+// GUI thread: running min/mean/max per stage since the last reset
+class ProfileStats {
+public:
+  struct Row {
+    double min = std::numeric_limits<double>::max();
+    double max = 0.0;
+    double sum = 0.0;
+    juce::int64 count = 0;
+
+    void add(double micros) {
+      this->min = std::min(this->min, micros);
+      this->max = std::max(this->max, micros);
+      this->sum += micros;
+      this->count++;
+    }
+    double mean() const { return this->count > 0 ? this->sum / static_cast<double>(this->count) : 0.0; }
+  };
+
+private:
+  std::vector<Row> stages;
+  Row block;
+  double deadlineSum = 0.0;
+
+public:
+  void reset() {
+    this->stages.clear();
+    this->block = Row{};
+    this->deadlineSum = 0.0;
+  }
+
+  // Bypassed stages report no time and are left out of their own stats
+  void add(const ProfileFrame& frame) {
+    if (static_cast<int>(this->stages.size()) < frame.numStages) {
+      this->stages.resize(static_cast<size_t>(frame.numStages));
+    }
+    for (int i = 0; i < frame.numStages; i++) {
+      if (frame.stageMicros[i] > 0.f) { this->stages[static_cast<size_t>(i)].add(frame.stageMicros[i]); }
+    }
+    this->block.add(frame.blockMicros);
+    this->deadlineSum += frame.deadlineMicros;
+  }
+
+  int getNumStages() const { return static_cast<int>(this->stages.size()); }
+  const Row& getStage(int index) const { return this->stages[static_cast<size_t>(index)]; }
+  const Row& getBlock() const { return this->block; }
+
+  // average block deadline, the budget every percentage is relative to
+  double meanDeadline() const {
+    return this->block.count > 0 ? this->deadlineSum / static_cast<double>(this->block.count) : 0.0;
+  }
+
+  double percentOfDeadline(double micros) const {
+    double deadline = this->meanDeadline();
+    return deadline > 0.0 ? 100.0 * micros / deadline : 0.0;
+  }
+
+  juce::String toCsv(const juce::StringArray& names) const {
+    juce::String csv = "stage,blocks,min_us,mean_us,max_us,mean_pct,max_pct\n";
+    auto addRow = [&](const juce::String& name, const Row& row) {
+      if (row.count == 0) { return; }
+      csv << name << "," << row.count << ","
+          << juce::String(row.min, 3) << "," << juce::String(row.mean(), 3) << "," << juce::String(row.max, 3) << ","
+          << juce::String(this->percentOfDeadline(row.mean()), 2) << ","
+          << juce::String(this->percentOfDeadline(row.max), 2) << "\n";
+    };
+    for (int i = 0; i < this->getNumStages(); i++) {
+      addRow(i < names.size() ? names[i] : juce::String(i), this->getStage(i));
+    }
+    addRow("processBlock", this->block);
+    return csv;
+  }
+};
+
+// Live table shown next to the scopes
+class ProfilerView : public juce::Component, private juce::Timer {
+private:
+  ChainProfiler& profiler;
+  juce::StringArray names;
+  ProfileStats stats;
+  std::vector<ProfileFrame> scratch;
+  juce::TextButton resetButton { "Reset" };
+  juce::TextButton exportButton { "Export CSV" };
+  std::unique_ptr<juce::FileChooser> chooser;
+
+  void timerCallback() override {
+    int n;
+    while ((n = this->profiler.pop(this->scratch.data(), static_cast<int>(this->scratch.size()))) > 0) {
+      for (int i = 0; i < n; i++) { this->stats.add(this->scratch[static_cast<size_t>(i)]); }
+    }
+    this->repaint();
+  }
+
+  void exportCsv() {
+    this->chooser = std::make_unique<juce::FileChooser>("Export timings", juce::File(), "*.csv");
+    this->chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles,
+                               [this](const juce::FileChooser& fc) {
+                                 auto file = fc.getResult();
+                                 if (file != juce::File()) { file.replaceWithText(this->stats.toCsv(this->names)); }
+                               });
+  }
+
+public:
+  ProfilerView(ChainProfiler& p, const juce::StringArray& effectNames)
+      : profiler(p), names(effectNames), scratch(64) {
+    this->resetButton.onClick = [this] { this->stats.reset(); };
+    this->exportButton.onClick = [this] { this->exportCsv(); };
+    this->addAndMakeVisible(this->resetButton);
+    this->addAndMakeVisible(this->exportButton);
+    this->startTimerHz(10);
+  }
+
+  void paint(juce::Graphics& g) override {
+    g.fillAll(juce::Colours::black);
+    g.setColour(juce::Colours::white);
+    g.setFont(12.f);
+
+    auto area = this->getLocalBounds().reduced(4).withTrimmedTop(24);
+    const int rowHeight = 14;
+    auto drawRow = [&](const juce::String& name, const juce::String& a, const juce::String& b,
+                       const juce::String& c, const juce::String& d) {
+      auto row = area.removeFromTop(rowHeight);
+      const int w = row.getWidth() / 5;
+      g.drawText(name, row.removeFromLeft(w), juce::Justification::left);
+      g.drawText(a, row.removeFromLeft(w), juce::Justification::right);
+      g.drawText(b, row.removeFromLeft(w), juce::Justification::right);
+      g.drawText(c, row.removeFromLeft(w), juce::Justification::right);
+      g.drawText(d, row, juce::Justification::right);
+    };
+    auto drawStats = [&](const juce::String& name, const ProfileStats::Row& row) {
+      if (row.count == 0) { drawRow(name, "-", "-", "-", "off"); return; }
+      drawRow(name, juce::String(row.min, 1), juce::String(row.mean(), 1), juce::String(row.max, 1),
+              juce::String(this->stats.percentOfDeadline(row.mean()), 1) + "%");
+    };
+
+    drawRow("us / block", "min", "mean", "max", "of deadline");
+    for (int i = 0; i < this->stats.getNumStages(); i++) {
+      drawStats(i < this->names.size() ? this->names[i] : juce::String(i), this->stats.getStage(i));
+    }
+    drawStats("processBlock", this->stats.getBlock());
+  }
+
+  void resized() override {
+    auto top = this->getLocalBounds().reduced(2).removeFromTop(20);
+    this->exportButton.setBounds(top.removeFromRight(90));
+    this->resetButton.setBounds(top.removeFromRight(60));
+  }
+};
+
+  #define GIMMEL_PROFILE_BLOCK(profiler, numSamples) ScopedBlockTimer gimmelBlockTimer(profiler, numSamples)
+  #define GIMMEL_PROFILE_STAGE(profiler, index) ScopedStageTimer gimmelStageTimer(profiler, index)
+#else
+  #define GIMMEL_PROFILE_BLOCK(profiler, numSamples)
+  #define GIMMEL_PROFILE_STAGE(profiler, index)
+#endif
@@ -0,0 +1,44 @@
+//====================================================================================================
+/* RealtimeCheck.hpp
+
+Debug instrumentation for real-time safety. When GIMMEL_RT_CHECK is defined, processBlock marks
+its thread as being inside a real-time section, and the allocator and mutex hooks installed by
+the GIMMEL-RTCHECK harness (tools/RealtimeCheck.cpp) report any call made while that mark is
+set. Without GIMMEL_RT_CHECK the marker compiles to nothing.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+namespace rtcheck {
+
+// true while the calling thread is inside processBlock
+inline thread_local bool inRealtimeSection = false;
+
+class ScopedRealtimeSection {
+private:
+  bool previous;
+
+public:
+  ScopedRealtimeSection() : previous(inRealtimeSection) { inRealtimeSection = true; }
+  ~ScopedRealtimeSection() { inRealtimeSection = previous; }
+};
+
+// lets hooks (and code they call) step outside the section, e.g. to report a violation
+class ScopedNonRealtime {
+private:
+  bool previous;
+
+public:
+  ScopedNonRealtime() : previous(inRealtimeSection) { inRealtimeSection = false; }
+  ~ScopedNonRealtime() { inRealtimeSection = previous; }
+};
+
+} // namespace rtcheck
+
+#if GIMMEL_RT_CHECK
+  #define GIMMEL_REALTIME_SECTION rtcheck::ScopedRealtimeSection gimmelRealtimeSection
+#else
+  #define GIMMEL_REALTIME_SECTION
+#endif
@@ -0,0 +1,49 @@
+//====================================================================================================
+/* ScopeFeed.hpp
+
+Carries the input and output signals from processBlock to the editor's scopes. The audio
+thread copies each block into a LockFreeRing per scope, and only while an editor is attached;
+decimation and peak reduction happen on the GUI thread when the editor drains the rings.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include "LockFreeRing.hpp"
+
+class ScopeFeed {
+public:
+  enum Scope { Input = 0, Output, NumScopes };
+
+private:
+  // sized once for the highest rate we support, so prepareToPlay never reallocates
+  // a ring the editor may be reading: ~340 ms at 192 kHz
+  static constexpr int kCapacity = 1 << 16;
+
+  LockFreeRing<float> rings[NumScopes];
+  std::atomic<bool> attached { false };
+
+public:
+  ScopeFeed() {
+    for (auto& ring : this->rings) { ring.prepare(kCapacity); }
+  }
+  ~ScopeFeed() {}
+
+  // audio thread: one copy per block, nothing at all while no editor is open.
+  // If the editor falls behind the newest samples are dropped
+  void push(Scope scope, const float* samples, int numSamples) {
+    if (!this->attached.load(std::memory_order_relaxed)) { return; }
+    this->rings[scope].push(samples, numSamples);
+  }
+
+  // message thread, from the editor
+  void attach() {
+    for (auto& ring : this->rings) { ring.discard(); } // stale audio from a previous editor
+    this->attached.store(true);
+  }
+  void detach() { this->attached.store(false); }
+
+  int pop(Scope scope, float* dest, int maxSamples) { return this->rings[scope].pop(dest, maxSamples); }
+};
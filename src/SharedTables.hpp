@@ -0,0 +1,98 @@
+//====================================================================================================
+/* SharedTables.hpp
+
+Process-wide cache of read-only lookup tables. Tables are keyed by type, size and sample rate
+and handed out as shared_ptr<const>, so every AudioPluginAudioProcessor in a session shares one
+copy of each. Two tables live here: the equal-power fade the chain's bypass crossfades, the
+convolution reverb's engine swaps and program changes read, and the spectrum analyzer's Hann
+window. The tables giml builds inside its effects (the reverb's delay lengths, its
+oscillators) stay per instance; they are out of reach of this tree.
+
+The cache only holds weak references; a table is freed when the last instance lets go of it.
+Lookups take a lock and may build a table, so call them from prepare or a background thread,
+never from processBlock.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <juce_core/juce_core.h>
+
+using SharedTable = std::shared_ptr<const std::vector<float>>;
+
+class SharedTables {
+public:
+  enum class Type { EqualPowerFade, HannWindow };
+
+private:
+  struct Key {
+    Type type;
+    int size;
+    double sampleRate; // 0 for tables that don't depend on it
+
+    bool operator<(const Key& other) const {
+      return std::tie(this->type, this->size, this->sampleRate) < std::tie(other.type, other.size, other.sampleRate);
+    }
+  };
+
+  struct Cache {
+    std::mutex lock;
+    std::map<Key, std::weak_ptr<const std::vector<float>>> tables;
+  };
+
+  static Cache& cache() {
+    static Cache instance; // one per process, shared by every plugin instance
+    return instance;
+  }
+
+  // returns the live table for `key`, or builds it with `fill(std::vector<float>&)`
+  template <typename Fill>
+  static SharedTable get(const Key& key, Fill&& fill) {
+    Cache& c = cache();
+    std::lock_guard<std::mutex> guard(c.lock);
+
+    auto it = c.tables.find(key);
+    if (it != c.tables.end()) {
+      if (auto table = it->second.lock()) { return table; }
+    }
+
+    auto table = std::make_shared<std::vector<float>>(static_cast<size_t>(key.size));
+    fill(*table);
+    c.tables[key] = table;
+
+    // drop entries nobody holds any more
+    for (auto e = c.tables.begin(); e != c.tables.end();) {
+      e = e->second.expired() ? c.tables.erase(e) : std::next(e);
+    }
+    return table;
+  }
+
+public:
+  // sin(pi/2 * i / length) for i in 0..length: wet gain at fade position i, the dry gain is
+  // the same table read backwards. `length` is the fade time in samples at `sampleRate`
+  static SharedTable equalPowerFade(double sampleRate, double fadeMs) {
+    const int length = std::max(1, static_cast<int>(std::round(fadeMs * 0.001 * sampleRate)));
+    return get({ Type::EqualPowerFade, length + 1, sampleRate }, [length](std::vector<float>& t) {
+      for (int i = 0; i <= length; i++) {
+        t[static_cast<size_t>(i)] = static_cast<float>(std::sin(juce::MathConstants<double>::halfPi * i / length));
+      }
+    });
+  }
+
+  // periodic Hann window, for overlapped FFT analysis
+  static SharedTable hannWindow(int size) {
+    return get({ Type::HannWindow, size, 0.0 }, [size](std::vector<float>& t) {
+      for (int i = 0; i < size; i++) {
+        t[static_cast<size_t>(i)] = static_cast<float>(0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * i / size));
+      }
+    });
+  }
+};
@@ -0,0 +1,238 @@
+//====================================================================================================
+/* SpectrumAnalyzer.hpp
+
+Input and output spectra for the editor. processBlock only copies each block into a
+LockFreeRing per signal; a background thread runs windowed FFTs with 75% overlap and
+exponential averaging, and publishes magnitude spectra the SpectrumView draws. The thread only
+runs while an editor is open, and the audio thread writes nothing while it is stopped.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <juce_audio_utils/juce_audio_utils.h>
+#include <juce_dsp/juce_dsp.h>
+#include "LockFreeRing.hpp"
+#include "SharedTables.hpp"
+#include "FastMath.hpp"
+
+class SpectrumAnalyzer : private juce::Thread {
+public:
+  enum Signal { Input = 0, Output, NumSignals };
+
+  static constexpr int kMinOrder = 9;  // 512
+  static constexpr int kMaxOrder = 14; // 16384
+
+private:
+  // sized once so the rings never move under the audio thread: ~170 ms at 192 kHz,
+  // plenty for a thread that wakes every few ms
+  static constexpr int kCapacity = 1 << 15;
+
+  struct Channel {
+    LockFreeRing<float> ring;
+    std::vector<float> history;    // the last fftSize samples, newest hop at the end
+    std::vector<float> fftData;    // 2 * fftSize, as juce::dsp::FFT wants
+    std::vector<float> magnitudes; // averaged, linear
+    int numNew = 0;                // samples of the current hop received so far
+  };
+
+  Channel channels[NumSignals];
+  std::unique_ptr<juce::dsp::FFT> fft;
+  SharedTable window; // shared with every other instance analysing at this size
+  int fftOrder = 0;
+  std::atomic<int> requestedOrder { 11 };
+  std::atomic<float> averaging { 0.8f };
+  std::atomic<bool> running { false };
+
+  // spectra handed to the GUI; only this thread and the message thread take the lock
+  juce::CriticalSection publishLock;
+  std::vector<float> published[NumSignals];
+
+  int fftSize() const { return 1 << this->fftOrder; }
+  int hopSize() const { return this->fftSize() / 4; }
+
+  void configure(int order) {
+    this->fftOrder = order;
+    const auto size = static_cast<size_t>(this->fftSize());
+    this->fft = std::make_unique<juce::dsp::FFT>(order);
+    this->window = SharedTables::hannWindow(this->fftSize());
+    for (auto& c : this->channels) {
+      c.history.assign(size, 0.f);
+      c.fftData.assign(size * 2, 0.f);
+      c.magnitudes.assign(size / 2, 0.f);
+      c.numNew = 0;
+    }
+    const juce::ScopedLock lock(this->publishLock);
+    for (auto& spectrum : this->published) { spectrum.assign(size / 2, 0.f); }
+  }
+
+  // Runs every complete hop waiting in the ring. Returns true if a new frame was analysed
+  bool analyse(Channel& c, std::vector<float>& out) {
+    const int size = this->fftSize();
+    const int hop = this->hopSize();
+    bool analysed = false;
+
+    while (true) {
+      float* dest = c.history.data() + (size - hop + c.numNew);
+      c.numNew += c.ring.pop(dest, hop - c.numNew);
+      if (c.numNew < hop) { return analysed; }
+
+      std::copy(c.history.begin(), c.history.end(), c.fftData.begin());
+      std::fill(c.fftData.begin() + size, c.fftData.end(), 0.f);
+      juce::FloatVectorOperations::multiply(c.fftData.data(), this->window->data(), size);
+      this->fft->performFrequencyOnlyForwardTransform(c.fftData.data(), true);
+
+      // a full-scale sine reads as 1 after the Hann window's coherent gain of 0.5
+      const float scale = 4.f / static_cast<float>(size);
+      const float avg = this->averaging.load();
+      for (size_t k = 0; k < c.magnitudes.size(); k++) {
+        c.magnitudes[k] = avg * c.magnitudes[k] + (1.f - avg) * c.fftData[k] * scale;
+      }
+
+      std::copy(c.history.begin() + hop, c.history.end(), c.history.begin());
+      c.numNew = 0;
+      analysed = true;
+
+      const juce::ScopedLock lock(this->publishLock);
+      out = c.magnitudes;
+    }
+  }
+
+  void run() override {
+    while (!this->threadShouldExit()) {
+      const int order = this->requestedOrder.load();
+      if (order != this->fftOrder) { this->configure(order); }
+
+      bool analysed = false;
+      for (int s = 0; s < NumSignals; s++) {
+        analysed |= this->analyse(this->channels[s], this->published[s]);
+      }
+      if (!analysed) { this->wait(5); }
+    }
+  }
+
+public:
+  SpectrumAnalyzer() : juce::Thread("Spectrum analyzer") {
+    for (auto& c : this->channels) { c.ring.prepare(kCapacity); }
+  }
+  ~SpectrumAnalyzer() { this->stop(); }
+
+  //==============================================================================
+  // audio thread: one copy per block, nothing while the analyzer is stopped
+  void push(Signal signal, const float* samples, int numSamples) {
+    if (!this->running.load(std::memory_order_relaxed)) { return; }
+    this->channels[signal].ring.push(samples, numSamples);
+  }
+
+  //==============================================================================
+  // message thread
+
+  void start() {
+    if (this->isThreadRunning()) { return; }
+    for (auto& c : this->channels) { c.ring.discard(); }
+    this->running.store(true);
+    this->startThread();
+  }
+
+  void stop() {
+    this->running.store(false);
+    this->stopThread(1000);
+  }
+
+  // FFT size is 2^order, clamped to kMinOrder..kMaxOrder. Applied by the analyzer thread
+  void setFftOrder(int order) { this->requestedOrder.store(juce::jlimit(kMinOrder, kMaxOrder, order)); }
+  int getFftOrder() const { return this->requestedOrder.load(); }
+
+  // 0 shows every frame as is, values towards 1 average over more frames
+  void setAveraging(float amount) { this->averaging.store(juce::jlimit(0.f, 0.99f, amount)); }
+  float getAveraging() const { return this->averaging.load(); }
+
+  // copies the latest magnitudes (fftSize / 2 bins, linear) into `dest`
+  void getSpectrum(Signal signal, std::vector<float>& dest) {
+    const juce::ScopedLock lock(this->publishLock);
+    dest = this->published[signal];
+  }
+};
+
+// Log-frequency, dB spectrum of the input and output, with FFT size and averaging controls
+class SpectrumView : public juce::Component, private juce::Timer {
+private:
+  SpectrumAnalyzer& analyzer;
+  std::function<double()> getSampleRate;
+  std::vector<float> spectra[SpectrumAnalyzer::NumSignals];
+  juce::ComboBox sizeBox;
+  juce::Slider averagingSlider;
+
+  static constexpr float kMinDb = -100.f;
+  static constexpr float kMinHz = 20.f;
+
+  void timerCallback() override {
+    for (int s = 0; s < SpectrumAnalyzer::NumSignals; s++) {
+      this->analyzer.getSpectrum(static_cast<SpectrumAnalyzer::Signal>(s), this->spectra[s]);
+    }
+    this->repaint();
+  }
+
+  juce::Path makePath(const std::vector<float>& bins, juce::Rectangle<float> area, double sampleRate) const {
+    juce::Path path;
+    if (bins.size() < 2 || sampleRate <= 0.0) { return path; }
+
+    const float nyquist = static_cast<float>(sampleRate * 0.5);
+    const float binHz = nyquist / static_cast<float>(bins.size());
+    const float octaves = FastMath::log2(nyquist / kMinHz);
+    bool started = false;
+    for (size_t k = 1; k < bins.size(); k++) {
+      const float hz = static_cast<float>(k) * binHz;
+      if (hz < kMinHz) { continue; }
+      const float x = area.getX() + area.getWidth() * FastMath::log2(hz / kMinHz) / octaves;
+      const float db = juce::jmax(kMinDb, FastMath::gainToDb(bins[k])); // 0 reads as -759 dB
+      const float y = juce::jmap(db, kMinDb, 0.f, area.getBottom(), area.getY());
+      if (!started) { path.startNewSubPath(x, y); started = true; }
+      else { path.lineTo(x, y); }
+    }
+    return path;
+  }
+
+public:
+  SpectrumView(SpectrumAnalyzer& a, std::function<double()> sampleRateFn)
+      : analyzer(a), getSampleRate(std::move(sampleRateFn)) {
+    for (int order = SpectrumAnalyzer::kMinOrder; order <= SpectrumAnalyzer::kMaxOrder; order++) {
+      this->sizeBox.addItem(juce::String(1 << order), order);
+    }
+    this->sizeBox.setSelectedId(this->analyzer.getFftOrder(), juce::dontSendNotification);
+    this->sizeBox.onChange = [this] { this->analyzer.setFftOrder(this->sizeBox.getSelectedId()); };
+    this->addAndMakeVisible(this->sizeBox);
+
+    this->averagingSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    this->averagingSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 40, 20);
+    this->averagingSlider.setRange(0.0, 0.99, 0.01);
+    this->averagingSlider.setValue(this->analyzer.getAveraging(), juce::dontSendNotification);
+    this->averagingSlider.onValueChange = [this] {
+      this->analyzer.setAveraging(static_cast<float>(this->averagingSlider.getValue()));
+    };
+    this->addAndMakeVisible(this->averagingSlider);
+
+    this->startTimerHz(30);
+  }
+
+  void paint(juce::Graphics& g) override {
+    g.fillAll(juce::Colours::black);
+    auto area = this->getLocalBounds().withTrimmedTop(24).toFloat();
+    const double sampleRate = this->getSampleRate();
+
+    g.setColour(juce::Colours::grey);
+    g.strokePath(this->makePath(this->spectra[SpectrumAnalyzer::Input], area, sampleRate), juce::PathStrokeType(1.f));
+    g.setColour(juce::Colours::blue);
+    g.strokePath(this->makePath(this->spectra[SpectrumAnalyzer::Output], area, sampleRate), juce::PathStrokeType(1.5f));
+  }
+
+  void resized() override {
+    auto top = this->getLocalBounds().reduced(2).removeFromTop(20);
+    this->sizeBox.setBounds(top.removeFromLeft(80));
+    this->averagingSlider.setBounds(top.removeFromLeft(160));
+  }
+};
@@ -0,0 +1,64 @@
+//====================================================================================================
+/* StaticEffectsLine.hpp
+
+A fixed line of giml effects whose order is known at compile time. The effects live inline in
+a std::tuple and each sample runs through them in a fold expression with qualified
+processSample() calls, so there's no pointer chasing or virtual dispatch and the compiler can
+inline the whole line into one loop. giml::EffectsLine and EffectsChain stay the way to build
+lines that change at runtime; GIMMEL-BENCH compares the three.
+
+  StaticEffectsLine<giml::Chorus<float>, giml::Delay<float>> line(48000);
+  line.get<1>().setParams(250.f);
+  line.processBlock(in, out, numSamples);
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+template <class... Effects>
+class StaticEffectsLine {
+private:
+  std::tuple<Effects...> effects;
+
+  // every effect is built from the sample rate alone, in place: giml effects needn't be movable
+  template <class>
+  static int rateFor(int sampleRate) { return sampleRate; }
+
+  template <size_t... I>
+  float processSample(float x, std::index_sequence<I...>) {
+    ((x = std::get<I>(this->effects).Effects::processSample(x)), ...);
+    return x;
+  }
+
+public:
+  static constexpr size_t size() { return sizeof...(Effects); }
+
+  // Effects start enabled; toggle them through get<I>() like any giml effect
+  explicit StaticEffectsLine(int sampleRate) : effects(rateFor<Effects>(sampleRate)...) {
+    this->forEach([](auto& fx) { fx.toggle(true); });
+  }
+  ~StaticEffectsLine() {}
+
+  template <size_t I>
+  auto& get() { return std::get<I>(this->effects); }
+
+  // calls `fn(effect)` on each effect in line order
+  template <typename Fn>
+  void forEach(Fn&& fn) {
+    std::apply([&fn](auto&... fx) { (fn(fx), ...); }, this->effects);
+  }
+
+  float processSample(float in) { return this->processSample(in, std::index_sequence_for<Effects...>{}); }
+
+  // one channel; `in` and `out` may be the same buffer
+  void processBlock(const float* in, float* out, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+      out[i] = this->processSample(in[i], std::index_sequence_for<Effects...>{});
+    }
+  }
+};
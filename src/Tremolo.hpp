@@ -0,0 +1,94 @@
+//====================================================================================================
+/* Tremolo.hpp
+
+Tremolo fed by the processor's LfoBank instead of an oscillator of its own. The response
+matches giml::Tremolo: the gain dips by up to `depth` once per cycle and the speed is in ms per
+cycle, with the option of locking the cycle to the host tempo. One LFO drives every channel.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <functional>
+#include "EffectsChain.hpp"
+#include "LfoBank.hpp"
+
+class TremoloStage : public BlockEffect {
+private:
+  LfoBank* bank = nullptr;
+  int lfo = 0;
+  float speedMs = 1000.f;
+  float depth = 0.5f;
+  int sync = 0; // LfoBank::getSyncChoices() index, 0 runs free at speedMs
+  std::function<void(TremoloStage&, int)> setter;
+
+  // read position in the bank's current block; sub-blocks of one block read on from here
+  uint32_t blockCount = 0;
+  int cursor = 0;
+
+public:
+  TremoloStage() {}
+  ~TremoloStage() {}
+
+  // takes an LFO from `b`; call before the bank is prepared
+  void attach(LfoBank& b) {
+    this->bank = &b;
+    this->lfo = b.add(LfoBank::Shape::Sine);
+  }
+
+  // `fn(stage, offset)` pushes the bundle's values at `offset` into the stage
+  void bindParams(ParameterBundle& bundle, std::function<void(TremoloStage&, int)> fn) {
+    this->bindBundle(bundle);
+    this->setter = std::move(fn);
+  }
+
+  void updateParams(int offset) override {
+    if (this->setter) { this->setter(*this, offset); }
+  }
+
+  // Speed changes reach the LFO at the next block, depth at the next sub-block
+  void setParams(float speed = 1000.f, float d = 0.5f, int syncChoice = 0) {
+    this->speedMs = speed;
+    this->depth = d;
+    this->sync = syncChoice;
+  }
+
+  // audio thread, before the bank renders the block
+  void updateLfo(const LfoBank::Transport& transport) {
+    if (this->bank == nullptr) { return; }
+    this->bank->setActive(this->lfo, this->isEnabled());
+
+    const double beats = LfoBank::getSyncBeats(this->sync);
+    if (beats > 0.0 && transport.valid) {
+      this->bank->syncToTransport(this->lfo, transport, beats);
+    } else {
+      this->bank->setFrequency(this->lfo, 1000.0 / std::max(this->speedMs, 1.f));
+    }
+  }
+
+  void processBlock(const float* const* in, float* const* out, int numChannels, int numSamples) override {
+    if (this->bank == nullptr) { return; }
+    if (this->bank->getBlockCount() != this->blockCount) {
+      this->blockCount = this->bank->getBlockCount();
+      this->cursor = 0;
+    }
+
+    // past what the bank rendered (blocks larger than prepared): pass through
+    if (this->cursor + numSamples > this->bank->getMaxBlockSize()) {
+      for (int ch = 0; ch < numChannels; ch++) {
+        if (in[ch] != out[ch]) { std::copy(in[ch], in[ch] + numSamples, out[ch]); }
+      }
+      return;
+    }
+
+    const float* mod = this->bank->getBuffer(this->lfo) + this->cursor;
+    const float halfDepth = this->depth * 0.5f;
+    for (int ch = 0; ch < numChannels; ch++) {
+      for (int i = 0; i < numSamples; i++) {
+        out[ch][i] = in[ch][i] * (1.f - (mod[i] + 1.f) * halfDepth);
+      }
+    }
+    this->cursor += numSamples;
+  }
+};
@@ -0,0 +1,468 @@
+//====================================================================================================
+/* Benchmark.cpp
+
+Microbenchmarks for the giml effects, the LFO bank, the ways of lining effects up and the full
+chain, swept over
+block sizes 16-2048 and sample rates 44.1k-192k. Results are written as JSON so runs can be
+diffed when the Gimmel submodule moves.
+
+Usage:
+  GIMMEL-BENCH [--out results.json] [--seconds s] [--filter name]
+
+Effects are timed alone, one channel, through EffectSlot (the way the chain runs them). The
+chain cases run the whole AudioPluginAudioProcessor in stereo: every effect on, every effect
+off, and an empty chain, so the cost of bypassed effects can be read off directly.
+
+The line cases run the same nine effects on one channel three ways: inline in a
+StaticEffectsLine, through giml::EffectsLine's virtual calls, and as EffectSlots in an
+EffectsChain.
+
+The editor cases time the message thread instead, in ns per call: opening the editor, and one
+host automation change while it's open (every attachment on that parameter updates
+synchronously).
+
+FastCompressor and FastEnvelopeFilter (src/Dynamics.hpp) are FastMath alternatives to giml's
+compressor and envelope filter, timed the same way. The processor still runs the giml ones.
+
+The FastMath cases time each approximation at every accuracy tier, whatever GIMMEL_FAST_MATH
+the build picked, in ns per call over a block of 4096 values, with the largest absolute and
+relative error against the double-precision std:: function over the same values, 0 and 1
+among them. The relative error covers values near 0 too; where the reference is exactly 0 it
+counts the absolute error.
+
+*/
+//====================================================================================================
+
+#include "../src/PluginProcessor.h"
+#include "../src/StaticEffectsLine.hpp"
+#include "../src/FastMath.hpp"
+#include "../src/Dynamics.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+namespace
+{
+struct Options
+{
+    juce::File out;
+    double seconds = 1.0; // audio per measurement
+    juce::String filter;
+};
+
+const int blockSizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+
+void fillNoise (juce::AudioBuffer<float>& buffer)
+{
+    juce::Random random (1234);
+    for (int ch = 0; ch < buffer.getNumChannels(); ch++)
+        for (int i = 0; i < buffer.getNumSamples(); i++)
+            buffer.getWritePointer (ch)[i] = (random.nextFloat() * 2.f - 1.f) * 0.25f;
+}
+
+// Times `processOneBlock` over `seconds` of audio, after a short warm-up. Returns ns per sample
+template <typename Fn>
+double timeNsPerSample (Fn&& processOneBlock, int blockSize, double sampleRate, double seconds)
+{
+    const int numBlocks = juce::jmax (1, static_cast<int> (seconds * sampleRate / blockSize));
+    for (int i = 0; i < numBlocks / 10 + 1; i++)
+        processOneBlock();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numBlocks; i++)
+        processOneBlock();
+    const auto stop = std::chrono::steady_clock::now();
+
+    const double ns = static_cast<double> (std::chrono::duration_cast<std::chrono::nanoseconds> (stop - start).count());
+    return ns / (static_cast<double> (numBlocks) * blockSize);
+}
+
+juce::var makeResult (const juce::String& name, double sampleRate, int blockSize, int channels, double nsPerSample)
+{
+    auto* result = new juce::DynamicObject();
+    result->setProperty ("name", name);
+    result->setProperty ("sampleRate", sampleRate);
+    result->setProperty ("blockSize", blockSize);
+    result->setProperty ("channels", channels);
+    result->setProperty ("nsPerSample", nsPerSample);
+    result->setProperty ("samplesPerSecond", nsPerSample > 0.0 ? 1.0e9 / nsPerSample : 0.0);
+    result->setProperty ("realtimeFactor", nsPerSample > 0.0 ? 1.0e9 / (nsPerSample * sampleRate) : 0.0);
+    return juce::var (result);
+}
+
+template <class Fx, class Setup>
+void benchEffect (const juce::String& name, Setup setup, const Options& options, juce::Array<juce::var>& results)
+{
+    if (options.filter.isNotEmpty() && ! name.containsIgnoreCase (options.filter))
+        return;
+
+    for (double sampleRate : sampleRates)
+    {
+        for (int blockSize : blockSizes)
+        {
+            EffectSlot<Fx> slot;
+            slot.prepare (static_cast<int> (sampleRate), 1);
+            slot.forEachLane (setup);
+
+            juce::AudioBuffer<float> input (1, blockSize), output (1, blockSize);
+            fillNoise (input);
+            const float* in[] = { input.getReadPointer (0) };
+            float* out[] = { output.getWritePointer (0) };
+
+            juce::ScopedNoDenormals noDenormals;
+            double ns = timeNsPerSample ([&] { slot.processBlock (in, out, 1, blockSize); },
+                                         blockSize, sampleRate, options.seconds);
+            results.add (makeResult (name, sampleRate, blockSize, 1, ns));
+        }
+        std::fprintf (stderr, "  %s @ %.0f Hz\n", name.toRawUTF8(), sampleRate);
+    }
+}
+
+// renders `numLfos` sine LFOs per block, the way the processor's bank runs. ns per sample
+// covers the whole bank
+void benchLfoBank (int numLfos, const Options& options, juce::Array<juce::var>& results)
+{
+    const juce::String name = "LfoBank (" + juce::String (numLfos) + " LFOs)";
+    if (options.filter.isNotEmpty() && ! name.containsIgnoreCase (options.filter))
+        return;
+
+    for (double sampleRate : sampleRates)
+    {
+        for (int blockSize : blockSizes)
+        {
+            LfoBank bank;
+            for (int n = 0; n < numLfos; n++)
+                bank.add (LfoBank::Shape::Sine);
+            bank.prepare (sampleRate, blockSize);
+            for (int n = 0; n < numLfos; n++)
+            {
+                bank.setActive (n, true);
+                bank.setFrequency (n, 0.5 + n);
+            }
+
+            double ns = timeNsPerSample ([&] { bank.process (blockSize); }, blockSize, sampleRate, options.seconds);
+            results.add (makeResult (name, sampleRate, blockSize, 1, ns));
+        }
+        std::fprintf (stderr, "  %s @ %.0f Hz\n", name.toRawUTF8(), sampleRate);
+    }
+}
+
+// prepareToPlay's defaults for each giml effect
+struct SetDefaults
+{
+    template <class Fx>
+    void operator() (Fx& fx) const { fx.setParams(); }
+    void operator() (giml::Reverb<float>& fx) const { fx.setParams (0.03f, 0.3f, 0.5f, 0.5f, 50.f, 0.9f); }
+    void operator() (giml::EnvelopeFilter<float>& fx) const { juce::ignoreUnused (fx); }
+};
+
+using StaticLine = StaticEffectsLine<giml::Chorus<float>, giml::Compressor<float>, giml::Delay<float>, giml::Detune<float>,
+                                     giml::Flanger<float>, giml::Phaser<float>, giml::Reverb<float>, giml::Tremolo<float>,
+                                     giml::EnvelopeFilter<float>>;
+
+// runs one block of `in` into `out`, built for `sampleRate`
+using LineFactory = std::function<std::function<void (const float*, float*, int)> (int sampleRate)>;
+
+void benchLine (const juce::String& name, LineFactory makeLine, const Options& options, juce::Array<juce::var>& results)
+{
+    if (options.filter.isNotEmpty() && ! name.containsIgnoreCase (options.filter))
+        return;
+
+    for (double sampleRate : sampleRates)
+    {
+        for (int blockSize : blockSizes)
+        {
+            auto process = makeLine (static_cast<int> (sampleRate));
+            juce::AudioBuffer<float> input (1, blockSize), output (1, blockSize);
+            fillNoise (input);
+            const float* in = input.getReadPointer (0);
+            float* out = output.getWritePointer (0);
+
+            juce::ScopedNoDenormals noDenormals;
+            double ns = timeNsPerSample ([&] { process (in, out, blockSize); }, blockSize, sampleRate, options.seconds);
+            results.add (makeResult (name, sampleRate, blockSize, 1, ns));
+        }
+        std::fprintf (stderr, "  %s @ %.0f Hz\n", name.toRawUTF8(), sampleRate);
+    }
+}
+
+std::function<void (const float*, float*, int)> makeStaticLine (int sampleRate)
+{
+    auto line = std::make_shared<StaticLine> (sampleRate);
+    line->forEach (SetDefaults());
+    return [line] (const float* in, float* out, int n) { line->processBlock (in, out, n); };
+}
+
+std::function<void (const float*, float*, int)> makeGimlLine (int sampleRate)
+{
+    // the effects outlive the line that points at them
+    struct Owner
+    {
+        giml::Chorus<float> chorus; giml::Compressor<float> compressor; giml::Delay<float> delay;
+        giml::Detune<float> detune; giml::Flanger<float> flanger; giml::Phaser<float> phaser;
+        giml::Reverb<float> reverb; giml::Tremolo<float> tremolo; giml::EnvelopeFilter<float> envelope;
+        giml::EffectsLine<float> line;
+
+        explicit Owner (int sr)
+            : chorus (sr), compressor (sr), delay (sr), detune (sr), flanger (sr), phaser (sr), reverb (sr), tremolo (sr), envelope (sr)
+        {
+            auto add = [this] (auto& fx) { SetDefaults() (fx); fx.toggle (true); line.pushBack (&fx); };
+            add (chorus); add (compressor); add (delay); add (detune); add (flanger);
+            add (phaser); add (reverb); add (tremolo); add (envelope);
+        }
+    };
+    auto owner = std::make_shared<Owner> (sampleRate);
+    return [owner] (const float* in, float* out, int n) {
+        for (int i = 0; i < n; i++)
+            out[i] = owner->line.processSample (in[i]);
+    };
+}
+
+std::function<void (const float*, float*, int)> makeChainLine (int sampleRate)
+{
+    struct Owner
+    {
+        EffectSlot<giml::Chorus<float>> chorus; EffectSlot<giml::Compressor<float>> compressor; EffectSlot<giml::Delay<float>> delay;
+        EffectSlot<giml::Detune<float>> detune; EffectSlot<giml::Flanger<float>> flanger; EffectSlot<giml::Phaser<float>> phaser;
+        EffectSlot<giml::Reverb<float>> reverb; EffectSlot<giml::Tremolo<float>> tremolo; EffectSlot<giml::EnvelopeFilter<float>> envelope;
+        EffectsChain chain;
+
+        explicit Owner (int sr)
+        {
+            // slots without a bundle are always on and never re-read their params
+            auto add = [this, sr] (auto& slot) { slot.prepare (sr, 1); slot.forEachLane (SetDefaults()); chain.pushBack (&slot); };
+            add (chorus); add (compressor); add (delay); add (detune); add (flanger);
+            add (phaser); add (reverb); add (tremolo); add (envelope);
+        }
+    };
+    auto owner = std::make_shared<Owner> (sampleRate);
+    owner->chain.prepare (sampleRate, blockSizes[std::size (blockSizes) - 1]);
+    return [owner] (const float* in, float* out, int n) { owner->chain.processBlock (&in, &out, 1, n); };
+}
+
+void setAllToggles (AudioPluginAudioProcessor& processor, bool on)
+{
+    for (auto* bundle : processor.fxParams)
+        for (auto* param : *bundle)
+            if (param->isToggle())
+                processor.treeState.getParameter (param->getName())->setValueNotifyingHost (on ? 1.f : 0.f);
+}
+
+// `configure` sets toggles and order on a fresh processor
+template <typename Configure>
+void benchChain (const juce::String& name, Configure configure, const Options& options, juce::Array<juce::var>& results)
+{
+    if (options.filter.isNotEmpty() && ! name.containsIgnoreCase (options.filter))
+        return;
+
+    for (double sampleRate : sampleRates)
+    {
+        for (int blockSize : blockSizes)
+        {
+            AudioPluginAudioProcessor processor;
+            configure (processor);
+            processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+            processor.prepareToPlay (sampleRate, blockSize);
+
+            juce::AudioBuffer<float> noise (2, blockSize), buffer (2, blockSize);
+            fillNoise (noise);
+            juce::MidiBuffer midi;
+
+            double ns = timeNsPerSample ([&] {
+                                             buffer.makeCopyOf (noise, true);
+                                             processor.processBlock (buffer, midi);
+                                         },
+                                         blockSize, sampleRate, options.seconds);
+            results.add (makeResult (name, sampleRate, blockSize, 2, ns));
+            processor.releaseResources();
+        }
+        std::fprintf (stderr, "  %s @ %.0f Hz\n", name.toRawUTF8(), sampleRate);
+    }
+}
+
+juce::var makeCallResult (const juce::String& name, int calls, double nsPerCall)
+{
+    auto* result = new juce::DynamicObject();
+    result->setProperty ("name", name);
+    result->setProperty ("calls", calls);
+    result->setProperty ("nsPerCall", nsPerCall);
+    return juce::var (result);
+}
+
+void benchEditor (const Options& options, juce::Array<juce::var>& results)
+{
+    if (options.filter.isNotEmpty() && ! juce::String ("Editor").containsIgnoreCase (options.filter))
+        return;
+
+    AudioPluginAudioProcessor processor;
+    const int opens = juce::jmax (1, static_cast<int> (options.seconds * 50));
+    std::chrono::nanoseconds opening {};
+    for (int i = 0; i < opens; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<juce::AudioProcessorEditor> editor (processor.createEditor());
+        opening += std::chrono::steady_clock::now() - start;
+    }
+    results.add (makeCallResult ("Editor (open)", opens, static_cast<double> (opening.count()) / opens));
+
+    // every parameter moved in turn, back and forth, with the editor showing its first tab
+    std::unique_ptr<juce::AudioProcessorEditor> editor (processor.createEditor());
+    juce::Array<juce::RangedAudioParameter*> params;
+    processor.fxParams.forEachParameter ([&] (Parameter& p, int) { params.add (processor.treeState.getParameter (p.getName())); });
+
+    const int rounds = juce::jmax (2, static_cast<int> (options.seconds * 200));
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (auto* param : params)
+            param->setValueNotifyingHost (r % 2 == 0 ? 0.25f : 0.75f);
+    const auto changing = std::chrono::steady_clock::now() - start;
+    const int changes = rounds * params.size();
+    results.add (makeCallResult ("Editor (automation change)", changes, static_cast<double> (changing.count()) / changes));
+    std::fprintf (stderr, "  Editor\n");
+}
+
+template <FastMath::Tier T>
+using TierTag = std::integral_constant<FastMath::Tier, T>;
+
+// `fn (tier, x)` at every tier over [lo, hi], spaced evenly or (`geometric`) by ratio, against
+// `reference (x)` in double
+template <typename Fn, typename Reference>
+void benchFastMath (const juce::String& name, Fn&& fn, Reference&& reference, double lo, double hi, bool geometric,
+                    const Options& options, juce::Array<juce::var>& results)
+{
+    if (options.filter.isNotEmpty() && ! ("FastMath " + name).containsIgnoreCase (options.filter))
+        return;
+
+    // the last values are the range's landmarks: 0 and 1, where most of these are exactly 0 or 1
+    constexpr int numValues = 4096;
+    std::vector<float> in (numValues), out (numValues);
+    for (int i = 0; i < numValues - 2; i++)
+    {
+        const double a = i / static_cast<double> (numValues - 3);
+        in[static_cast<size_t> (i)] = static_cast<float> (geometric ? lo * std::pow (hi / lo, a) : lo + (hi - lo) * a);
+    }
+    in[numValues - 2] = static_cast<float> (juce::jlimit (lo, hi, 0.0));
+    in[numValues - 1] = static_cast<float> (juce::jlimit (lo, hi, 1.0));
+
+    auto run = [&] (auto tier, const char* tierName) {
+        const double ns = timeNsPerSample ([&] {
+            for (int i = 0; i < numValues; i++)
+                out[static_cast<size_t> (i)] = fn (tier, in[static_cast<size_t> (i)]);
+        }, numValues, 48000.0, options.seconds);
+
+        // relative error everywhere, the absolute error where the reference is exactly 0
+        double maxAbs = 0.0, maxRel = 0.0;
+        for (size_t i = 0; i < in.size(); i++)
+        {
+            const double expected = reference (static_cast<double> (in[i]));
+            const double error = std::abs (static_cast<double> (out[i]) - expected);
+            maxAbs = juce::jmax (maxAbs, error);
+            maxRel = juce::jmax (maxRel, expected != 0.0 ? error / std::abs (expected) : error);
+        }
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty ("name", "FastMath " + name + " (" + tierName + ")");
+        result->setProperty ("calls", numValues);
+        result->setProperty ("nsPerCall", ns);
+        result->setProperty ("maxAbsError", maxAbs);
+        result->setProperty ("maxRelError", maxRel);
+        results.add (juce::var (result));
+        std::fprintf (stderr, "  FastMath %-9s %-8s %6.2f ns  abs %.1e  rel %.1e\n",
+                      name.toRawUTF8(), tierName, ns, maxAbs, maxRel);
+    };
+    run (TierTag<FastMath::Tier::Exact>(), "exact");
+    run (TierTag<FastMath::Tier::Precise>(), "precise");
+    run (TierTag<FastMath::Tier::Fast>(), "fast");
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        juce::String arg (argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue)          options.out = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else if (arg == "--seconds" && hasValue) options.seconds = juce::jmax (0.01, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--filter" && hasValue)  options.filter = argv[++i];
+        else
+        {
+            std::fprintf (stderr, "usage: GIMMEL-BENCH [--out results.json] [--seconds s] [--filter name]\n");
+            return 1;
+        }
+    }
+
+    juce::Array<juce::var> results;
+
+    // same defaults prepareToPlay gives each effect
+    benchEffect<giml::Chorus<float>> ("Chorus", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<giml::Compressor<float>> ("Compressor", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<giml::Delay<float>> ("Delay", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<giml::Detune<float>> ("Detune", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<giml::Flanger<float>> ("Flanger", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<giml::Phaser<float>> ("Phaser", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<giml::Reverb<float>> ("Reverb", [] (auto& fx) { fx.setParams (0.03f, 0.3f, 0.5f, 0.5f, 50.f, 0.9f); }, options, results);
+    benchEffect<giml::Tremolo<float>> ("Tremolo", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<giml::EnvelopeFilter<float>> ("EnvelopeFilter", [] (auto& fx) { juce::ignoreUnused (fx); }, options, results);
+
+    // FastMath alternatives from Dynamics.hpp, against the giml effects above
+    benchEffect<FastCompressor> ("FastCompressor", [] (auto& fx) { fx.setParams(); }, options, results);
+    benchEffect<FastEnvelopeFilter> ("FastEnvelopeFilter", [] (auto& fx) { fx.setParams(); }, options, results);
+
+    // the processor's tremolo reads its LFO from the bank instead of running giml::Tremolo
+    benchLfoBank (1, options, results);
+    benchLfoBank (LfoBank::kMaxLfos, options, results);
+
+    benchLine ("StaticEffectsLine", makeStaticLine, options, results);
+    benchLine ("giml::EffectsLine", makeGimlLine, options, results);
+    benchLine ("EffectsChain (slots)", makeChainLine, options, results);
+
+    benchChain ("EffectsLine (all on)", [] (auto& p) { setAllToggles (p, true); }, options, results);
+    benchChain ("EffectsLine (all off)", [] (auto& p) { setAllToggles (p, false); }, options, results);
+    benchChain ("EffectsLine (empty)", [] (auto& p) { p.setEffectOrder ({}); }, options, results);
+
+    benchEditor (options, results);
+
+    benchFastMath ("exp2", [] (auto t, float x) { return FastMath::exp2<decltype (t)::value> (x); },
+                   [] (double x) { return std::exp2 (x); }, -20.0, 20.0, false, options, results);
+    benchFastMath ("log2", [] (auto t, float x) { return FastMath::log2<decltype (t)::value> (x); },
+                   [] (double x) { return std::log2 (x); }, 1.0e-4, 1.0e4, true, options, results);
+    benchFastMath ("dbToGain", [] (auto t, float x) { return FastMath::dbToGain<decltype (t)::value> (x); },
+                   [] (double x) { return std::pow (10.0, x / 20.0); }, -100.0, 24.0, false, options, results);
+    benchFastMath ("gainToDb", [] (auto t, float x) { return FastMath::gainToDb<decltype (t)::value> (x); },
+                   [] (double x) { return 20.0 * std::log10 (x); }, 1.0e-5, 16.0, true, options, results);
+    benchFastMath ("sin", [] (auto t, float x) { return FastMath::sin<decltype (t)::value> (x); },
+                   [] (double x) { return std::sin (x); }, -10.0, 10.0, false, options, results);
+    benchFastMath ("cos", [] (auto t, float x) { return FastMath::cos<decltype (t)::value> (x); },
+                   [] (double x) { return std::cos (x); }, -10.0, 10.0, false, options, results);
+    benchFastMath ("tan", [] (auto t, float x) { return FastMath::tan<decltype (t)::value> (x); },
+                   [] (double x) { return std::tan (x); }, -1.4, 1.4, false, options, results);
+    benchFastMath ("tanh", [] (auto t, float x) { return FastMath::tanh<decltype (t)::value> (x); },
+                   [] (double x) { return std::tanh (x); }, -6.0, 6.0, false, options, results);
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty ("date", juce::Time::getCurrentTime().toISO8601 (true));
+    root->setProperty ("secondsPerMeasurement", options.seconds);
+    root->setProperty ("results", results);
+
+    const auto json = juce::JSON::toString (juce::var (root));
+    if (options.out == juce::File())
+        std::printf ("%s\n", json.toRawUTF8());
+    else if (! options.out.replaceWithText (json))
+    {
+        std::fprintf (stderr, "error: can't write %s\n", options.out.getFullPathName().toRawUTF8());
+        return 1;
+    }
+    return 0;
+}
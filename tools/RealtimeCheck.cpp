@@ -0,0 +1,371 @@
+//====================================================================================================
+/* RealtimeCheck.cpp
+
+Real-time safety harness. Replaces the global allocation functions (operator new/delete and,
+on glibc, malloc/calloc/realloc/free) and pthread_mutex_lock with versions that report any call
+made while the calling thread is inside processBlock (see src/RealtimeCheck.hpp), with a stack
+trace. It then drives the processor with randomized parameter automation, toggles and chain
+reorders the way a host would, and exits non-zero if anything was reported.
+
+Besides host automation it exercises every path that hands something to the audio thread:
+program switches, timestamped changes (scheduleParameterChange), the file input with a file
+loaded, impulse response swaps and oversampling changes. The message loop is pumped between
+blocks, so the async rebuilds and the program sync timer run as they would in a host.
+
+Usage:
+  GIMMEL-RTCHECK [--blocks n] [--block n] [--rate hz]
+
+Host-side work (automation, reorders, filling the input, the message loop) runs outside the
+real-time section, so only what processBlock itself does is counted.
+
+*/
+//====================================================================================================
+
+#include "../src/PluginProcessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+  #include <execinfo.h>
+  #include <unistd.h>
+  #define GIMMEL_HAS_BACKTRACE 1
+#endif
+
+#if defined(__linux__) && defined(__GLIBC__)
+  #include <dlfcn.h>
+  #include <pthread.h>
+  #define GIMMEL_HOOK_LIBC 1
+extern "C" void* __libc_malloc (size_t);
+extern "C" void* __libc_calloc (size_t, size_t);
+extern "C" void* __libc_realloc (void*, size_t);
+extern "C" void* __libc_memalign (size_t, size_t);
+extern "C" void __libc_free (void*);
+#endif
+
+namespace
+{
+std::atomic<int> allocations { 0 };
+std::atomic<int> deallocations { 0 };
+std::atomic<int> locks { 0 };
+std::atomic<int> tracesPrinted { 0 };
+constexpr int kMaxTraces = 20;
+
+void writeStderr (const char* text)
+{
+   #if GIMMEL_HAS_BACKTRACE
+    ssize_t ignored = write (STDERR_FILENO, text, std::strlen (text));
+    juce::ignoreUnused (ignored);
+   #else
+    std::fputs (text, stderr);
+   #endif
+}
+
+// Must not allocate or lock: it runs inside the hooks
+void report (const char* what, std::atomic<int>& counter)
+{
+    if (! rtcheck::inRealtimeSection)
+        return;
+
+    rtcheck::ScopedNonRealtime reporting; // the report itself isn't a violation
+    counter.fetch_add (1);
+
+    if (tracesPrinted.fetch_add (1) < kMaxTraces)
+    {
+        writeStderr ("\n*** real-time violation in processBlock: ");
+        writeStderr (what);
+        writeStderr ("\n");
+       #if GIMMEL_HAS_BACKTRACE
+        void* frames[48];
+        int numFrames = backtrace (frames, 48);
+        backtrace_symbols_fd (frames, numFrames, STDERR_FILENO);
+       #endif
+    }
+}
+
+void* rawMalloc (size_t size)
+{
+   #if GIMMEL_HOOK_LIBC
+    return __libc_malloc (size);
+   #else
+    return std::malloc (size);
+   #endif
+}
+
+void* rawAlignedMalloc (size_t size, size_t alignment)
+{
+   #if GIMMEL_HOOK_LIBC
+    return __libc_memalign (alignment, size);
+   #else
+    void* ptr = nullptr;
+    return posix_memalign (&ptr, alignment, size) == 0 ? ptr : nullptr;
+   #endif
+}
+
+void rawFree (void* ptr)
+{
+   #if GIMMEL_HOOK_LIBC
+    __libc_free (ptr);
+   #else
+    std::free (ptr);
+   #endif
+}
+
+void* checkedNew (size_t size)
+{
+    report ("operator new", allocations);
+    if (void* ptr = rawMalloc (size > 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* checkedAlignedNew (size_t size, std::align_val_t alignment)
+{
+    report ("operator new (aligned)", allocations);
+    if (void* ptr = rawAlignedMalloc (size > 0 ? size : 1, static_cast<size_t> (alignment)))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void checkedDelete (void* ptr)
+{
+    if (ptr == nullptr)
+        return;
+    report ("operator delete", deallocations);
+    rawFree (ptr);
+}
+} // namespace
+
+//==============================================================================
+// global allocation functions
+void* operator new (size_t size)                                           { return checkedNew (size); }
+void* operator new[] (size_t size)                                         { return checkedNew (size); }
+void* operator new (size_t size, const std::nothrow_t&) noexcept           { try { return checkedNew (size); } catch (...) { return nullptr; } }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept         { try { return checkedNew (size); } catch (...) { return nullptr; } }
+void* operator new (size_t size, std::align_val_t al)                      { return checkedAlignedNew (size, al); }
+void* operator new[] (size_t size, std::align_val_t al)                    { return checkedAlignedNew (size, al); }
+void operator delete (void* ptr) noexcept                                  { checkedDelete (ptr); }
+void operator delete[] (void* ptr) noexcept                                { checkedDelete (ptr); }
+void operator delete (void* ptr, size_t) noexcept                          { checkedDelete (ptr); }
+void operator delete[] (void* ptr, size_t) noexcept                        { checkedDelete (ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept           { checkedDelete (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept         { checkedDelete (ptr); }
+void operator delete (void* ptr, std::align_val_t) noexcept                { checkedDelete (ptr); }
+void operator delete[] (void* ptr, std::align_val_t) noexcept              { checkedDelete (ptr); }
+void operator delete (void* ptr, size_t, std::align_val_t) noexcept        { checkedDelete (ptr); }
+void operator delete[] (void* ptr, size_t, std::align_val_t) noexcept      { checkedDelete (ptr); }
+
+#if GIMMEL_HOOK_LIBC
+//==============================================================================
+// glibc: interpose the C allocator and pthread mutexes as well
+extern "C"
+{
+void* malloc (size_t size)
+{
+    report ("malloc", allocations);
+    return __libc_malloc (size);
+}
+
+void* calloc (size_t count, size_t size)
+{
+    report ("calloc", allocations);
+    return __libc_calloc (count, size);
+}
+
+void* realloc (void* ptr, size_t size)
+{
+    report ("realloc", allocations);
+    return __libc_realloc (ptr, size);
+}
+
+int posix_memalign (void** out, size_t alignment, size_t size)
+{
+    report ("posix_memalign", allocations);
+    *out = __libc_memalign (alignment, size);
+    return *out != nullptr ? 0 : ENOMEM;
+}
+
+void free (void* ptr)
+{
+    if (ptr != nullptr)
+        report ("free", deallocations);
+    __libc_free (ptr);
+}
+
+int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    using LockFn = int (*) (pthread_mutex_t*);
+    static std::atomic<LockFn> real { nullptr };
+
+    LockFn fn = real.load (std::memory_order_relaxed);
+    if (fn == nullptr)
+    {
+        fn = reinterpret_cast<LockFn> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+        real.store (fn, std::memory_order_relaxed);
+    }
+
+    report ("pthread_mutex_lock", locks);
+    return fn (mutex);
+}
+}
+#endif
+
+namespace
+{
+// half a second of decaying stereo noise, used as the test file and as an impulse response
+juce::File writeTestFile (double sampleRate)
+{
+    auto file = juce::File::createTempFile ("wav");
+    auto stream = std::make_unique<juce::FileOutputStream> (file);
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate, 2, 24, {}, 0));
+    if (writer == nullptr)
+        return {};
+    stream.release(); // owned by the writer now
+
+    juce::AudioBuffer<float> noise (2, static_cast<int> (sampleRate * 0.5));
+    juce::Random random (7);
+    for (int ch = 0; ch < noise.getNumChannels(); ch++)
+        for (int i = 0; i < noise.getNumSamples(); i++)
+            noise.getWritePointer (ch)[i] = (random.nextFloat() * 2.f - 1.f) * 0.25f * std::exp (-8.f * i / noise.getNumSamples());
+    writer->writeFromAudioSampleBuffer (noise, 0, noise.getNumSamples());
+    return file;
+}
+
+void setChoice (AudioPluginAudioProcessor& processor, Parameter& param, int index)
+{
+    auto* p = processor.treeState.getParameter (param.getName());
+    p->setValueNotifyingHost (p->convertTo0to1 (static_cast<float> (index)));
+}
+} // namespace
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    int numBlocks = 20000;
+    int blockSize = 32;
+    double sampleRate = 48000.0;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        juce::String arg (argv[i]), value (argv[i + 1]);
+        if (arg == "--blocks")     numBlocks = juce::jmax (1, value.getIntValue());
+        else if (arg == "--block") blockSize = juce::jmax (1, value.getIntValue());
+        else if (arg == "--rate")  sampleRate = juce::jmax (8000.0, value.getDoubleValue());
+    }
+
+   #if GIMMEL_HAS_BACKTRACE
+    void* warmup[1];
+    backtrace (warmup, 1); // the first call loads libgcc, which allocates
+   #endif
+
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    AudioPluginAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    // oversampling is a setup change, driven below where the harness can follow its re-prepare
+    const std::vector<Parameter*> oversampling { &processor.chorusOversampling, &processor.compressorOversampling,
+                                                 &processor.detuneOversampling, &processor.flangerOversampling };
+    std::vector<juce::RangedAudioParameter*> params;
+    for (auto* bundle : processor.fxParams)
+    {
+        for (auto* param : *bundle)
+        {
+            auto* p = processor.treeState.getParameter (param->getName());
+            if (param->isToggle())
+                p->setValueNotifyingHost (1.f); // start with everything on
+            if (std::find (oversampling.begin(), oversampling.end(), param) == oversampling.end())
+                params.push_back (p);
+        }
+    }
+    const int numEffects = processor.getEffectNames().size();
+
+    const auto testFile = writeTestFile (sampleRate);
+    if (! processor.filePlayer.load (testFile) || ! processor.loadImpulseResponse (testFile))
+        std::printf ("warning: can't load the test file, the file input and IR paths go unchecked\n");
+    auto* messageManager = juce::MessageManager::getInstance();
+    juce::int64 position = 0; // the processor's samplePosition, for scheduleParameterChange
+
+    juce::AudioBuffer<float> buffer (2, blockSize);
+    juce::MidiBuffer midi;
+    juce::Random random (42);
+
+    for (int block = 0; block < numBlocks; block++)
+    {
+        // host side: automation every few blocks, occasional toggles and reorders
+        if (block % 8 == 0)
+        {
+            for (int n = random.nextInt (4) + 1; n > 0; n--)
+                params[static_cast<size_t> (random.nextInt (static_cast<int> (params.size())))]->setValueNotifyingHost (random.nextFloat());
+        }
+        if (block % 2000 == 1999)
+        {
+            std::vector<int> order;
+            for (int i = 0; i < numEffects; i++)
+                if (random.nextInt (4) != 0)
+                    order.insert (order.begin() + random.nextInt (static_cast<int> (order.size()) + 1), i);
+            processor.setEffectOrder (order);
+        }
+
+        // timestamped changes a few blocks ahead, in time order
+        if (block % 16 == 0)
+        {
+            juce::int64 time = position;
+            for (int n = random.nextInt (3) + 1; n > 0; n--)
+            {
+                auto* p = params[static_cast<size_t> (random.nextInt (static_cast<int> (params.size())))];
+                time += random.nextInt (blockSize * 2);
+                processor.scheduleParameterChange (p->getParameterID(), p->convertFrom0to1 (random.nextFloat()), time);
+            }
+        }
+
+        if (block % 1000 == 250)
+            processor.setCurrentProgram (random.nextInt (processor.getNumPrograms()));
+        if (block % 1000 == 500)
+            setChoice (processor, processor.inputSource, 1 - processor.inputSource.getIndex()); // live <-> file
+        if (block % 3000 == 1500)
+        {
+            setChoice (processor, processor.reverbMode, 1 + random.nextInt (2)); // room or file IR
+            if (random.nextBool())
+                processor.loadImpulseResponse (testFile);
+        }
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ch++)
+            for (int i = 0; i < blockSize; i++)
+                buffer.getWritePointer (ch)[i] = (random.nextFloat() * 2.f - 1.f) * 0.25f;
+
+        processor.processBlock (buffer, midi);
+        position += blockSize;
+
+        // the message thread's share: async rebuilds, IR swaps and the program sync timer. An
+        // oversampling change re-prepares, which restarts the processor's sample count
+        if (block % 16 == 15)
+        {
+            const bool reprepare = block % 4000 == 3999;
+            if (reprepare)
+                setChoice (processor, *oversampling[static_cast<size_t> (random.nextInt (static_cast<int> (oversampling.size())))],
+                           random.nextInt (processor.oversamplingChoices.size()));
+            messageManager->runDispatchLoopUntil (1);
+            if (reprepare)
+                position = 0;
+        }
+    }
+
+    processor.releaseResources();
+    testFile.deleteFile();
+
+    const int total = allocations.load() + deallocations.load() + locks.load();
+    std::printf ("%d blocks of %d samples at %.0f Hz: %d allocation(s), %d deallocation(s), %d lock(s) in processBlock\n",
+                 numBlocks, blockSize, sampleRate, allocations.load(), deallocations.load(), locks.load());
+   #if ! GIMMEL_HOOK_LIBC
+    std::printf ("note: malloc/free and mutex hooks need glibc, only operator new/delete were checked\n");
+   #endif
+    return total == 0 ? 0 : 1;
+}
@@ -0,0 +1,496 @@
+//====================================================================================================
+/* Render.cpp
+
+Headless offline renderer: runs WAV files through the same AudioPluginAudioProcessor chain the
+plugin uses and writes the results as WAV, as fast as the machine allows. Files are rendered in
+parallel on a work-stealing pool, one processor per worker.
+
+Usage:
+  GIMMEL-RENDER [--preset file] [--automation file] [--out dir] [--block n] [--jobs n]
+                [--tail seconds] [--check-block n] in.wav...
+
+Preset files hold one `parameterId = value` per line in the parameter's own units (ms, dB,
+0/1 for toggles, the index for choices). `order = 6,2,0` sets the chain order by effect index,
+see AudioPluginAudioProcessor::getEffectNames(). Lines starting with # are ignored.
+
+Automation files hold one `seconds parameterId value` per line, values in the same units as
+presets. Changes are scheduled sample-accurately, to the processor's 32-sample grid. Setup
+parameters (oversampling, the reverb's mode and room) rebuild effects and can only be set by
+the preset; automating one is an error, and so is more automation in one block than the
+processor's queue holds.
+
+Changes, parameter ramps and the chain's control updates all sit on that grid counted from the
+start of the file, so they land on the same samples at any --block size. What does depend on
+it is below -90 dBFS: float rounding in ramps and LFOs, and stages that go quiet under
+-100 dBFS writing silence from the start of a block. `--check-block n` proves it for a file:
+it renders every input at --block and at n, writes nothing, prints the largest difference and
+fails if that is above kCheckToleranceDb.
+
+The tail is the processor's for the values the input's automation left behind. The output is
+latency-compensated: with oversampled effects on, the chain's delay is rendered past the end
+and trimmed from the start, so the result lines up with the input.
+
+*/
+//====================================================================================================
+
+#include "../src/PluginProcessor.h"
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+namespace
+{
+// largest difference --check-block accepts between two block sizes
+constexpr float kCheckToleranceDb = -90.f;
+
+struct Options
+{
+    juce::File preset;
+    juce::File automation;
+    juce::File outDir;
+    int blockSize = 512;
+    int jobs = juce::SystemStats::getNumCpus();
+    double tailSeconds = -1.0; // < 0 uses the processor's getTailLengthSeconds(), capped at a minute
+    int checkBlockSize = 0;    // > 0 compares renders at blockSize and this instead of writing
+    std::vector<juce::File> inputs;
+};
+
+struct Preset
+{
+    std::map<juce::String, float> values;
+    std::vector<int> order;
+};
+
+struct AutomationPoint
+{
+    double seconds = 0.0;
+    juce::String id;
+    float value = 0.f;
+};
+
+void printUsage()
+{
+    std::fprintf (stderr, "usage: GIMMEL-RENDER [--preset file] [--automation file] [--out dir] [--block n] "
+                          "[--jobs n] [--tail seconds] [--check-block n] in.wav...\n");
+}
+
+bool parseArgs (int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        juce::String arg (argv[i]);
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--preset" && hasValue)     options.preset = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else if (arg == "--automation" && hasValue) options.automation = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else if (arg == "--out" && hasValue)   options.outDir = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else if (arg == "--block" && hasValue) options.blockSize = juce::jmax (1, juce::String (argv[++i]).getIntValue());
+        else if (arg == "--jobs" && hasValue)  options.jobs = juce::jmax (1, juce::String (argv[++i]).getIntValue());
+        else if (arg == "--tail" && hasValue)  options.tailSeconds = juce::String (argv[++i]).getDoubleValue();
+        else if (arg == "--check-block" && hasValue) options.checkBlockSize = juce::jmax (1, juce::String (argv[++i]).getIntValue());
+        else if (arg.startsWith ("--"))        return false;
+        else                                   options.inputs.push_back (juce::File::getCurrentWorkingDirectory().getChildFile (arg));
+    }
+    return ! options.inputs.empty();
+}
+
+bool loadPreset (const juce::File& file, Preset& preset)
+{
+    if (! file.existsAsFile())
+        return false;
+
+    juce::StringArray lines;
+    file.readLines (lines);
+    for (auto& rawLine : lines)
+    {
+        auto line = rawLine.trim();
+        if (line.isEmpty() || line.startsWithChar ('#') || ! line.containsChar ('='))
+            continue;
+
+        auto key = line.upToFirstOccurrenceOf ("=", false, false).trim();
+        auto value = line.fromFirstOccurrenceOf ("=", false, false).trim();
+
+        if (key == "order")
+        {
+            juce::StringArray indices;
+            indices.addTokens (value, ",", "");
+            for (auto& index : indices)
+                preset.order.push_back (index.trim().getIntValue());
+        }
+        else
+        {
+            preset.values[key] = value.getFloatValue();
+        }
+    }
+    return true;
+}
+
+// sorted by time
+bool loadAutomation (const juce::File& file, std::vector<AutomationPoint>& points)
+{
+    if (! file.existsAsFile())
+        return false;
+
+    juce::StringArray lines;
+    file.readLines (lines);
+    for (auto& rawLine : lines)
+    {
+        auto line = rawLine.trim();
+        if (line.isEmpty() || line.startsWithChar ('#'))
+            continue;
+
+        juce::StringArray fields;
+        fields.addTokens (line, " \t", "");
+        fields.removeEmptyStrings();
+        if (fields.size() != 3)
+        {
+            std::fprintf (stderr, "warning: ignoring automation line '%s'\n", line.toRawUTF8());
+            continue;
+        }
+        points.push_back ({ fields[0].getDoubleValue(), fields[1], fields[2].getFloatValue() });
+    }
+    std::stable_sort (points.begin(), points.end(), [] (const auto& a, const auto& b) { return a.seconds < b.seconds; });
+    return true;
+}
+
+void applyPreset (AudioPluginAudioProcessor& processor, const Preset& preset)
+{
+    for (auto& [id, value] : preset.values)
+    {
+        if (auto* param = processor.treeState.getParameter (id))
+            param->setValueNotifyingHost (param->convertTo0to1 (value));
+        else
+            std::fprintf (stderr, "warning: unknown parameter '%s'\n", id.toRawUTF8());
+    }
+
+    if (! preset.order.empty())
+        processor.setEffectOrder (preset.order);
+}
+
+juce::File outputFileFor (const juce::File& input, const Options& options)
+{
+    auto name = input.getFileNameWithoutExtension() + "-fx.wav";
+    return options.outDir == juce::File() ? input.getParentDirectory().getChildFile (name)
+                                          : options.outDir.getChildFile (name);
+}
+
+std::unique_ptr<juce::AudioFormatReader> openInput (const juce::File& input)
+{
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatReader> reader (wav.createReaderFor (new juce::FileInputStream (input), true));
+    if (reader == nullptr)
+        std::fprintf (stderr, "error: can't read %s\n", input.getFullPathName().toRawUTF8());
+    return reader;
+}
+
+// Scheduled changes never reach the treeState, which the processor's tail follows. Sets it to
+// the values the automation holds at `time` and returns the tail for them, capped: the processor
+// reports an infinite tail while feedback is set not to decay. An explicit --tail is taken as given
+double tailSecondsAt (AudioPluginAudioProcessor& processor, const Options& options,
+                      const std::vector<AutomationPoint>& automation, juce::int64 time, double sampleRate)
+{
+    constexpr double kMaxTailSeconds = 60.0;
+    if (options.tailSeconds >= 0.0)
+        return options.tailSeconds;
+
+    std::map<juce::String, float> held;
+    for (const auto& point : automation)
+    {
+        if (static_cast<juce::int64> (point.seconds * sampleRate) < time)
+            held[point.id] = point.value;
+    }
+    for (auto& [id, value] : held)
+    {
+        auto* param = processor.treeState.getParameter (id);
+        param->setValueNotifyingHost (param->convertTo0to1 (value));
+    }
+    processor.handlePendingChanges(); // no message loop runs here
+    return juce::jmin (kMaxTailSeconds, processor.getTailLengthSeconds());
+}
+
+// Runs `reader` through the worker's processor in blocks of `blockSize`, handing the
+// latency-trimmed output to `write (buffer, start, numSamples)`. Returns the samples rendered,
+// or -1 if a block's automation didn't fit the processor's queue
+template <typename Write>
+juce::int64 process (AudioPluginAudioProcessor& processor, juce::AudioFormatReader& reader, int blockSize,
+                     const Options& options, const std::vector<AutomationPoint>& automation, Write&& write)
+{
+    const int numChannels = juce::jlimit (1, 2, static_cast<int> (reader.numChannels));
+    const double sampleRate = reader.sampleRate;
+    const auto layout = numChannels == 1 ? juce::AudioChannelSet::mono() : juce::AudioChannelSet::stereo();
+
+    juce::AudioProcessor::BusesLayout buses;
+    buses.inputBuses.add (layout);
+    buses.outputBuses.add (layout);
+    processor.setBusesLayout (buses);
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    // the treeState is put back afterwards, so the next file starts from the preset again
+    std::map<juce::String, float> preset;
+    for (const auto& point : automation)
+        preset.emplace (point.id, processor.treeState.getParameter (point.id)->getValue());
+    auto finish = [&] {
+        for (auto& [id, value] : preset)
+            processor.treeState.getParameter (id)->setValueNotifyingHost (value);
+        processor.releaseResources();
+    };
+
+    // The input is rendered first, ending on a block of its own so the tail is measured at the
+    // same sample for any block size, then the tail and the latency
+    const juce::int64 length = reader.lengthInSamples;
+    const int latency = processor.getLatencySamples(); // rendered past the end, dropped from the start
+    juce::int64 total = -1;                             // the input and its tail, once it has played
+    juce::int64 end = length;
+
+    juce::AudioBuffer<float> buffer (numChannels, blockSize);
+    juce::MidiBuffer midi;
+    size_t nextPoint = 0;
+    for (juce::int64 pos = 0;;)
+    {
+        if (pos >= end)
+        {
+            if (total >= 0)
+                break;
+            total = length + static_cast<juce::int64> (tailSecondsAt (processor, options, automation, length, sampleRate) * sampleRate);
+            end = total + latency;
+            continue;
+        }
+        const int n = static_cast<int> (juce::jmin<juce::int64> (blockSize, end - pos));
+
+        // hand over this block's automation
+        for (; nextPoint < automation.size(); ++nextPoint)
+        {
+            const auto& point = automation[nextPoint];
+            const auto time = static_cast<juce::int64> (point.seconds * sampleRate);
+            if (time >= pos + n)
+                break;
+            if (! processor.scheduleParameterChange (point.id, point.value, time))
+            {
+                std::fprintf (stderr, "error: the block at %.3f s has more automation than the processor's queue holds (%d), "
+                                      "use a smaller --block\n", static_cast<double> (pos) / sampleRate, AutomationQueue::kCapacity);
+                finish();
+                return -1;
+            }
+        }
+        buffer.setSize (numChannels, n, false, false, true);
+        buffer.clear();
+        if (pos < reader.lengthInSamples)
+            reader.read (&buffer, 0, n, pos, true, numChannels > 1);
+
+        processor.processBlock (buffer, midi);
+        const int skip = static_cast<int> (juce::jlimit<juce::int64> (0, n, latency - pos));
+        if (skip < n)
+            write (buffer, skip, n - skip);
+        pos += n;
+    }
+
+    finish();
+    return total;
+}
+
+// Renders one file with the worker's processor. Returns the seconds of audio rendered, or -1
+// if the file failed
+double renderFile (AudioPluginAudioProcessor& processor, const juce::File& input, const Options& options,
+                   const std::vector<AutomationPoint>& automation)
+{
+    auto reader = openInput (input);
+    if (reader == nullptr)
+        return -1.0;
+
+    auto outFile = outputFileFor (input, options);
+    outFile.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream> (outFile);
+    if (! stream->openedOk())
+    {
+        std::fprintf (stderr, "error: can't write %s\n", outFile.getFullPathName().toRawUTF8());
+        return -1.0;
+    }
+
+    juce::WavAudioFormat wav;
+    const int numChannels = juce::jlimit (1, 2, static_cast<int> (reader->numChannels));
+    std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), reader->sampleRate,
+                                                                          static_cast<unsigned int> (numChannels),
+                                                                          24, {}, 0));
+    if (writer == nullptr)
+        return -1.0;
+    stream.release(); // owned by the writer now
+
+    const auto total = process (processor, *reader, options.blockSize, options, automation,
+                                [&] (const juce::AudioBuffer<float>& buffer, int start, int numSamples) {
+                                    writer->writeFromAudioSampleBuffer (buffer, start, numSamples);
+                                });
+    if (total < 0)
+    {
+        writer.reset();
+        outFile.deleteFile(); // cut short, not worth keeping
+        return -1.0;
+    }
+    return static_cast<double> (total) / reader->sampleRate;
+}
+
+// Renders one file at --block and at --check-block and compares the two. Returns false if
+// they differ by more than kCheckToleranceDb or can't be rendered
+bool checkFile (AudioPluginAudioProcessor& processor, const juce::File& input, const Options& options,
+                const std::vector<AutomationPoint>& automation)
+{
+    auto reader = openInput (input);
+    if (reader == nullptr)
+        return false;
+
+    bool rendered = true;
+    auto render = [&] (int blockSize) {
+        std::vector<std::vector<float>> channels;
+        rendered &= process (processor, *reader, blockSize, options, automation,
+                             [&] (const juce::AudioBuffer<float>& buffer, int start, int numSamples) {
+                                 channels.resize (static_cast<size_t> (buffer.getNumChannels()));
+                                 for (int ch = 0; ch < buffer.getNumChannels(); ch++)
+                                 {
+                                     const float* data = buffer.getReadPointer (ch, start);
+                                     channels[static_cast<size_t> (ch)].insert (channels[static_cast<size_t> (ch)].end(), data, data + numSamples);
+                                 }
+                             }) >= 0;
+        return channels;
+    };
+    const auto a = render (options.blockSize);
+    const auto b = render (options.checkBlockSize);
+    if (! rendered)
+        return false;
+
+    if (a.size() != b.size() || (! a.empty() && a.front().size() != b.front().size()))
+    {
+        std::fprintf (stderr, "%s: --block %d and %d render different lengths\n",
+                      input.getFileName().toRawUTF8(), options.blockSize, options.checkBlockSize);
+        return false;
+    }
+
+    float peak = 0.f;
+    for (size_t ch = 0; ch < a.size(); ch++)
+    {
+        for (size_t i = 0; i < a[ch].size(); i++)
+            peak = juce::jmax (peak, std::abs (a[ch][i] - b[ch][i]));
+    }
+
+    const float db = juce::Decibels::gainToDecibels (peak, -200.f);
+    std::printf ("%s: --block %d vs %d differ by at most %.1f dBFS\n",
+                 input.getFileName().toRawUTF8(), options.blockSize, options.checkBlockSize, db);
+    return db <= kCheckToleranceDb;
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    Options options;
+    if (! parseArgs (argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Preset preset;
+    if (options.preset != juce::File() && ! loadPreset (options.preset, preset))
+    {
+        std::fprintf (stderr, "error: can't read preset %s\n", options.preset.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    std::vector<AutomationPoint> automation;
+    if (options.automation != juce::File() && ! loadAutomation (options.automation, automation))
+    {
+        std::fprintf (stderr, "error: can't read automation %s\n", options.automation.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    if (options.outDir != juce::File())
+        options.outDir.createDirectory();
+
+    // processors are built here on the main thread, then each worker renders with its own
+    const int numWorkers = juce::jmin (options.jobs, static_cast<int> (options.inputs.size()));
+    std::vector<std::unique_ptr<AudioPluginAudioProcessor>> processors;
+    for (int i = 0; i < numWorkers; i++)
+    {
+        processors.push_back (std::make_unique<AudioPluginAudioProcessor>());
+        processors.back()->setNonRealtime (true);
+        applyPreset (*processors.back(), preset);
+    }
+
+    // setup parameters would never take effect, fail rather than render without them
+    bool setupAutomated = false;
+    for (const auto& point : automation)
+    {
+        if (processors.front()->isSetupParameter (point.id))
+        {
+            std::fprintf (stderr, "error: '%s' is a setup parameter, set it in the preset instead of automating it\n",
+                          point.id.toRawUTF8());
+            setupAutomated = true;
+        }
+    }
+    if (setupAutomated)
+        return 1;
+
+    // unknown IDs would stall the queue, drop them up front
+    automation.erase (std::remove_if (automation.begin(), automation.end(), [&] (const AutomationPoint& point) {
+                          if (processors.front()->treeState.getParameter (point.id) != nullptr)
+                              return false;
+                          std::fprintf (stderr, "warning: unknown parameter '%s'\n", point.id.toRawUTF8());
+                          return true;
+                      }),
+                      automation.end());
+
+    if (options.checkBlockSize > 0)
+    {
+        std::atomic<bool> failed { false };
+        {
+            WorkStealingPool pool (numWorkers);
+            for (auto& input : options.inputs)
+            {
+                pool.submit ([&, input] (int worker) {
+                    if (! checkFile (*processors[static_cast<size_t> (worker)], input, options, automation))
+                        failed = true;
+                });
+            }
+            pool.wait();
+        }
+        return failed ? 1 : 0;
+    }
+
+    std::atomic<double> renderedSeconds { 0.0 };
+    std::atomic<bool> failed { false };
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    {
+        WorkStealingPool pool (numWorkers);
+        for (auto& input : options.inputs)
+        {
+            pool.submit ([&, input] (int worker) {
+                const double t0 = juce::Time::getMillisecondCounterHiRes();
+                const double seconds = renderFile (*processors[static_cast<size_t> (worker)], input, options, automation);
+                const double elapsed = (juce::Time::getMillisecondCounterHiRes() - t0) * 0.001;
+                if (seconds < 0.0)
+                {
+                    failed = true;
+                    return;
+                }
+
+                double expected = renderedSeconds.load();
+                while (! renderedSeconds.compare_exchange_weak (expected, expected + seconds)) {}
+
+                std::printf ("%s: %.1f s of audio in %.2f s (%.0fx realtime)\n",
+                             input.getFileName().toRawUTF8(), seconds, elapsed,
+                             elapsed > 0.0 ? seconds / elapsed : 0.0);
+            });
+        }
+        pool.wait();
+    }
+    const double wall = (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+
+    std::printf ("rendered %d file(s), %.1f s of audio in %.2f s on %d worker(s)\n",
+                 static_cast<int> (options.inputs.size()), renderedSeconds.load(), wall, numWorkers);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+//====================================================================================================
+/* Stress.cpp
+
+Many-instance host simulation: how many copies of the chain fit on this machine. N processors
+run from a work-stealing pool the way a DAW spreads tracks over its audio threads, driven by a
+dummy device that fires a callback every block period from the system clock. Each callback
+hands every instance one block and waits for all of them; if that takes longer than the period,
+the deadline is missed. No audio device is needed.
+
+Usage:
+  GIMMEL-STRESS [--instances n] [--jobs n] [--block n] [--rate hz] [--seconds s]
+                [--automation changes/s] [--silent fraction] [--seed n] [--freewheel] [--out report.json]
+
+Every effect is on in every instance. Each instance gets random automation of its continuous
+parameters, on average `--automation` changes per second, applied at the start of the callback
+like a host does. `--silent` feeds that fraction of the instances silence, to see what idle
+tracks cost. `--freewheel` runs callbacks back to back instead of waiting for the clock, which
+measures the same thing faster.
+
+The report gives per-callback wall time and per-instance processBlock time as p50/p99/max,
+and the number of missed deadlines.
+
+*/
+//====================================================================================================
+
+#include "../src/PluginProcessor.h"
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    int instances = 16;
+    int jobs = juce::SystemStats::getNumCpus();
+    int blockSize = 256;
+    double sampleRate = 48000.0;
+    double seconds = 10.0;
+    double automationRate = 20.0; // changes per second per instance
+    double silentFraction = 0.0;
+    juce::int64 seed = 1234;
+    bool freewheel = false;
+    juce::File out;
+};
+
+void printUsage()
+{
+    std::fprintf (stderr, "usage: GIMMEL-STRESS [--instances n] [--jobs n] [--block n] [--rate hz] [--seconds s]\n"
+                          "                     [--automation changes/s] [--silent fraction] [--seed n] [--freewheel]\n"
+                          "                     [--out report.json]\n");
+}
+
+bool parseArgs (int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        juce::String arg (argv[i]);
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--instances" && hasValue)       options.instances = juce::jmax (1, juce::String (argv[++i]).getIntValue());
+        else if (arg == "--jobs" && hasValue)       options.jobs = juce::jmax (1, juce::String (argv[++i]).getIntValue());
+        else if (arg == "--block" && hasValue)      options.blockSize = juce::jmax (1, juce::String (argv[++i]).getIntValue());
+        else if (arg == "--rate" && hasValue)       options.sampleRate = juce::jmax (1.0, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--seconds" && hasValue)    options.seconds = juce::jmax (0.01, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--automation" && hasValue) options.automationRate = juce::jmax (0.0, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--silent" && hasValue)     options.silentFraction = juce::jlimit (0.0, 1.0, juce::String (argv[++i]).getDoubleValue());
+        else if (arg == "--seed" && hasValue)       options.seed = juce::String (argv[++i]).getLargeIntValue();
+        else if (arg == "--freewheel")              options.freewheel = true;
+        else if (arg == "--out" && hasValue)        options.out = juce::File::getCurrentWorkingDirectory().getChildFile (argv[++i]);
+        else                                        return false;
+    }
+    return true;
+}
+
+// one simulated track: a processor, its input and the parameters its automation moves
+struct Instance
+{
+    std::unique_ptr<AudioPluginAudioProcessor> processor = std::make_unique<AudioPluginAudioProcessor>();
+    juce::AudioBuffer<float> input, buffer;
+    std::vector<juce::RangedAudioParameter*> automated;
+    std::vector<double> times; // ns per callback
+};
+
+void prepare (Instance& instance, const Options& options, bool silent, juce::Random& random)
+{
+    auto& processor = *instance.processor;
+    juce::AudioProcessor::BusesLayout buses;
+    buses.inputBuses.add (juce::AudioChannelSet::stereo());
+    buses.outputBuses.add (juce::AudioChannelSet::stereo());
+    processor.setBusesLayout (buses);
+
+    // every effect on; choices pick setups (oversampling, reverb mode) and stay put
+    processor.fxParams.forEachParameter ([&] (Parameter& p, int) {
+        auto* param = processor.treeState.getParameter (p.getName());
+        if (p.isToggle())
+            param->setValueNotifyingHost (1.f);
+        else if (! p.isChoice())
+            instance.automated.push_back (param);
+    });
+
+    processor.setRateAndBufferSizeDetails (options.sampleRate, options.blockSize);
+    processor.prepareToPlay (options.sampleRate, options.blockSize);
+
+    instance.input.setSize (2, options.blockSize);
+    instance.buffer.setSize (2, options.blockSize);
+    instance.input.clear();
+    if (! silent)
+        for (int ch = 0; ch < 2; ch++)
+            for (int i = 0; i < options.blockSize; i++)
+                instance.input.getWritePointer (ch)[i] = (random.nextFloat() * 2.f - 1.f) * 0.25f;
+}
+
+struct Percentiles
+{
+    double p50 = 0.0, p99 = 0.0, max = 0.0, mean = 0.0;
+};
+
+Percentiles percentiles (std::vector<double> values)
+{
+    Percentiles p;
+    if (values.empty())
+        return p;
+    std::sort (values.begin(), values.end());
+    auto at = [&values] (double q) { return values[juce::jmin (values.size() - 1, static_cast<size_t> (q * values.size()))]; };
+    p.p50 = at (0.5);
+    p.p99 = at (0.99);
+    p.max = values.back();
+    for (double v : values)
+        p.mean += v;
+    p.mean /= static_cast<double> (values.size());
+    return p;
+}
+
+// in microseconds
+juce::var toVar (const Percentiles& p)
+{
+    auto* result = new juce::DynamicObject();
+    result->setProperty ("p50", p.p50 * 1.0e-3);
+    result->setProperty ("p99", p.p99 * 1.0e-3);
+    result->setProperty ("max", p.max * 1.0e-3);
+    result->setProperty ("mean", p.mean * 1.0e-3);
+    return juce::var (result);
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    Options options;
+    if (! parseArgs (argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    juce::Random random (options.seed);
+    const int numSilent = juce::roundToInt (options.silentFraction * options.instances);
+    std::vector<std::unique_ptr<Instance>> instances;
+    for (int i = 0; i < options.instances; i++)
+    {
+        instances.push_back (std::make_unique<Instance>());
+        prepare (*instances.back(), options, i < numSilent, random);
+    }
+
+    const auto period = std::chrono::nanoseconds (static_cast<juce::int64> (1.0e9 * options.blockSize / options.sampleRate));
+    const int numCallbacks = juce::jmax (1, static_cast<int> (options.seconds * options.sampleRate / options.blockSize));
+    const double changeChance = options.automationRate * options.blockSize / options.sampleRate;
+    for (auto& instance : instances)
+        instance->times.assign (static_cast<size_t> (numCallbacks), 0.0);
+
+    std::vector<double> callbackTimes (static_cast<size_t> (numCallbacks), 0.0);
+    int missed = 0;
+    const int numWorkers = juce::jmin (options.jobs, options.instances);
+    std::fprintf (stderr, "%d instance(s) on %d worker(s), %d samples @ %.0f Hz (%.2f ms deadline), %d callbacks\n",
+                  options.instances, numWorkers, options.blockSize, options.sampleRate,
+                  static_cast<double> (period.count()) * 1.0e-6, numCallbacks);
+    {
+        WorkStealingPool pool (numWorkers);
+        juce::MidiBuffer midi;
+        auto next = Clock::now();
+        for (int cb = 0; cb < numCallbacks; cb++)
+        {
+            if (! options.freewheel)
+                std::this_thread::sleep_until (next);
+
+            // automation arrives with the callback, before any instance runs
+            for (auto& instance : instances)
+            {
+                if (instance->automated.empty() || random.nextDouble() >= changeChance)
+                    continue;
+                auto* param = instance->automated[static_cast<size_t> (random.nextInt (static_cast<int> (instance->automated.size())))];
+                param->setValueNotifyingHost (random.nextFloat());
+            }
+
+            const auto start = Clock::now();
+            for (auto& instance : instances)
+            {
+                Instance* track = instance.get();
+                pool.submit ([track, cb, &midi] (int) {
+                    const auto t0 = Clock::now();
+                    track->buffer.makeCopyOf (track->input, true);
+                    track->processor->processBlock (track->buffer, midi);
+                    track->times[static_cast<size_t> (cb)] = static_cast<double> ((Clock::now() - t0).count());
+                });
+            }
+            pool.wait();
+            const auto elapsed = Clock::now() - start;
+
+            callbackTimes[static_cast<size_t> (cb)] = static_cast<double> (std::chrono::duration_cast<std::chrono::nanoseconds> (elapsed).count());
+            if (elapsed > period)
+                ++missed;
+
+            // a late callback doesn't make the device wait: the next one is due on the next period
+            next += period;
+            const auto now = Clock::now();
+            while (next < now)
+                next += period;
+        }
+    }
+
+    std::vector<double> instanceTimes;
+    instanceTimes.reserve (static_cast<size_t> (numCallbacks) * instances.size());
+    for (auto& instance : instances)
+    {
+        instance->processor->releaseResources();
+        instanceTimes.insert (instanceTimes.end(), instance->times.begin(), instance->times.end());
+    }
+
+    const auto callback = percentiles (callbackTimes);
+    const auto perInstance = percentiles (instanceTimes);
+    const double deadlineUs = static_cast<double> (period.count()) * 1.0e-3;
+    std::fprintf (stderr, "callback p50 %.0f us, p99 %.0f us, max %.0f us of %.0f us; %d missed deadline(s) (%.2f%%)\n",
+                  callback.p50 * 1.0e-3, callback.p99 * 1.0e-3, callback.max * 1.0e-3, deadlineUs,
+                  missed, 100.0 * missed / numCallbacks);
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty ("date", juce::Time::getCurrentTime().toISO8601 (true));
+    root->setProperty ("instances", options.instances);
+    root->setProperty ("silentInstances", numSilent);
+    root->setProperty ("workers", numWorkers);
+    root->setProperty ("blockSize", options.blockSize);
+    root->setProperty ("sampleRate", options.sampleRate);
+    root->setProperty ("freewheel", options.freewheel);
+    root->setProperty ("automationPerSecond", options.automationRate);
+    root->setProperty ("callbacks", numCallbacks);
+    root->setProperty ("deadlineUs", deadlineUs);
+    root->setProperty ("missedDeadlines", missed);
+    root->setProperty ("callbackUs", toVar (callback));
+    root->setProperty ("instanceUs", toVar (perInstance));
+    root->setProperty ("load", deadlineUs > 0.0 ? callback.mean * 1.0e-3 / deadlineUs : 0.0);
+
+    const auto json = juce::JSON::toString (juce::var (root));
+    if (options.out == juce::File())
+        std::printf ("%s\n", json.toRawUTF8());
+    else if (! options.out.replaceWithText (json))
+    {
+        std::fprintf (stderr, "error: can't write %s\n", options.out.getFullPathName().toRawUTF8());
+        return 1;
+    }
+    return 0;
+}
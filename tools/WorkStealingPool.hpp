@@ -0,0 +1,133 @@
+//====================================================================================================
+/* WorkStealingPool.hpp
+
+A small work-stealing thread pool for the headless tools. Every worker owns a deque: it takes
+its own work from the front and, once that runs dry, steals from the back of the others, so
+long jobs (big files, heavy presets) don't leave cores idle at the end of a batch.
+
+Tasks receive the index of the worker running them, which lets callers keep one processor per
+worker instead of one per task.
+
+*/
+//====================================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+  using Task = std::function<void(int worker)>;
+
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+  std::mutex sleepLock;
+  std::condition_variable wake, idle;
+  std::atomic<int> pending { 0 };
+  std::atomic<bool> quit { false };
+  int nextQueue = 0;
+
+  bool popOwn(int worker, Task& task) {
+    Queue& q = *this->queues[static_cast<size_t>(worker)];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty()) { return false; }
+    task = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    return true;
+  }
+
+  bool steal(int worker, Task& task) {
+    const int n = static_cast<int>(this->queues.size());
+    for (int i = 1; i < n; i++) {
+      Queue& victim = *this->queues[static_cast<size_t>((worker + i) % n)];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void workerLoop(int worker) {
+    Task task;
+    while (!this->quit.load()) {
+      if (this->popOwn(worker, task) || this->steal(worker, task)) {
+        task(worker);
+        task = nullptr;
+        if (this->pending.fetch_sub(1) == 1) {
+          std::lock_guard<std::mutex> guard(this->sleepLock);
+          this->idle.notify_all();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> guard(this->sleepLock);
+      this->wake.wait(guard, [this] { return this->quit.load() || this->hasQueuedWork(); });
+    }
+  }
+
+  bool hasQueuedWork() {
+    for (auto& q : this->queues) {
+      std::lock_guard<std::mutex> guard(q->lock);
+      if (!q->tasks.empty()) { return true; }
+    }
+    return false;
+  }
+
+public:
+  WorkStealingPool(int numWorkers) {
+    numWorkers = std::max(1, numWorkers);
+    for (int i = 0; i < numWorkers; i++) {
+      this->queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < numWorkers; i++) {
+      this->threads.emplace_back([this, i] { this->workerLoop(i); });
+    }
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> guard(this->sleepLock);
+      this->quit.store(true);
+    }
+    this->wake.notify_all();
+    for (auto& t : this->threads) { t.join(); }
+  }
+
+  int getNumWorkers() const { return static_cast<int>(this->queues.size()); }
+
+  // queues round-robin; idle workers steal whatever is left
+  void submit(Task task) {
+    this->pending.fetch_add(1);
+    Queue& q = *this->queues[static_cast<size_t>(this->nextQueue)];
+    this->nextQueue = (this->nextQueue + 1) % this->getNumWorkers();
+    {
+      std::lock_guard<std::mutex> guard(q.lock);
+      q.tasks.push_back(std::move(task));
+    }
+    std::lock_guard<std::mutex> guard(this->sleepLock);
+    this->wake.notify_all();
+  }
+
+  // blocks until every submitted task has finished
+  void wait() {
+    std::unique_lock<std::mutex> guard(this->sleepLock);
+    this->idle.wait(guard, [this] { return this->pending.load() == 0; });
+  }
+};